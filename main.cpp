@@ -8,67 +8,237 @@
  *
  *   El programa permite:
  *     - Mostrar los perfiles disponibles e iniciar sesión en uno de ellos.
+ *     - Guardar los perfiles en varios ficheros (fragmentos) que se cargan
+ *       en paralelo al arrancar.
  *     - Consultar, añadir, modificar y eliminar contactos de un perfil.
  *     - Importar contactos desde otro perfil evitando teléfonos duplicados.
- *     - Exportar los contactos de un perfil a otro.
+ *     - Exportar los contactos de un perfil a otro o a un fichero CSV/vCard.
  *     - Detectar contactos duplicados dentro de un mismo perfil.
+ *     - Detectar contactos parecidos (tildes, formato del telefono...).
+ *     - Calcular contactos en comun, exclusivos y la union entre perfiles.
+ *     - Buscar que perfiles tienen un telefono con un indice global inverso.
+ *     - Generar datos y trazas sinteticas y reproducir trazas para medir
+ *       el rendimiento (opciones --generar, --generar-traza, --reproducir).
  *
  *   Todas las estructuras de datos se han implementado usando únicamente
  *   punteros y una lista enlazada propia (plantilla LinkedList<T>), sin
- *   utilizar contenedores estándar de C++ como vector o list. Perfiles y
+ *   utilizar contenedores estándar de C++ como vector o list (con un modo
+ *   opcional de índice posicional para acceder por posición en O(log n)). Perfiles y
  *   contactos se crean dinámicamente con new y se gestionan mediante punteros.
+ *   Los contactos de cada perfil se guardan en una lista persistente
+ *   (plantilla ListaPersistente<T>) que permite tomar instantáneas.
  *
  * Autor/es:  Brent Delgado Ravichagua, Lucía Sánchez Grande
  * Grupo    : Grupo 5
  * Fecha    : 14/12/2025
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
-// Lista enlazada genérica
-template <typename T>
+#ifdef _WIN32
+// En Windows no hay writev: se escribe trozo a trozo con fwrite
+struct iovec {
+    void* iov_base;
+    std::size_t iov_len;
+};
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Politicas de propiedad para LinkedList.
+// ListaNoPropietaria: la lista solo guarda los datos, no los libera.
+struct ListaNoPropietaria {
+    template <typename E>
+    static void liberar(E&) {
+    }
+};
+
+// ListaPropietaria: la lista es duena de los punteros que guarda y los
+// borra con delete al eliminarlos o al vaciarse (en una sola pasada).
+struct ListaPropietaria {
+    template <typename E>
+    static void liberar(E& e) {
+        delete e;
+        e = nullptr;
+    }
+};
+
+// Lista enlazada genérica.
+// Tiene dos modos:
+//   - Simple (por defecto): lista enlazada de toda la vida; las operaciones
+//     por posicion recorren la lista desde el principio (O(n)).
+//   - Con indice posicional (LinkedList(true)): ademas del enlace "next",
+//     algunos nodos tienen saltos a nodos mas lejanos (lista de saltos o
+//     skip list) y guardan cuantas posiciones avanza cada salto. Asi
+//     obtener_en, insert_at y extract_at bajan a O(log n) de media.
+// En los dos modos la interfaz y los mensajes de error son los mismos.
+template <typename T, typename Propiedad = ListaNoPropietaria>
 class LinkedList {
 private:
+    // Niveles maximos del indice (suficiente para 2^32 elementos)
+    static const int MAX_NIVELES = 32;
+
     // Clase interna Nodo: cada elemento de la lista
     class Nodo {
     public:
-        T data;       // dato almacenado
-        Nodo* next;   // puntero al siguiente nodo
+        T data;         // dato almacenado
+        Nodo* next;     // puntero al siguiente nodo (nivel 0)
+        int niveles;    // niveles del nodo (1 = solo next)
+        Nodo** saltos;  // saltos[l-1]: siguiente nodo en el nivel l
+        int* anchos;    // anchos[l-1]: posiciones que avanza ese salto
 
         // Constructor por defecto
         Nodo() {
             data = T();        // valor por defecto del tipo T
             next = nullptr;    // siguiente nulo
+            niveles = 1;
+            saltos = nullptr;
+            anchos = nullptr;
         }
 
         // Constructor con dato
         Nodo(T e) {
             data = e;
             next = nullptr;
+            niveles = 1;
+            saltos = nullptr;
+            anchos = nullptr;
+        }
+
+        // Destructor: libera los niveles del indice
+        ~Nodo() {
+            delete[] saltos;
+            delete[] anchos;
+        }
+
+        // Reserva los niveles superiores del nodo
+        void crearNiveles(int n) {
+            niveles = n;
+            if (n > 1) {
+                saltos = new Nodo*[n - 1];
+                anchos = new int[n - 1];
+                for (int l = 0; l < n - 1; l++) {
+                    saltos[l] = nullptr;
+                    anchos[l] = 0;
+                }
+            }
+        }
+
+        // Siguiente nodo en el nivel l
+        Nodo* sig(int l) {
+            return l == 0 ? next : saltos[l - 1];
+        }
+
+        void setSig(int l, Nodo* n) {
+            if (l == 0) {
+                next = n;
+            } else {
+                saltos[l - 1] = n;
+            }
+        }
+
+        // Posiciones que avanza el salto del nivel l
+        int ancho(int l) {
+            return l == 0 ? 1 : anchos[l - 1];
+        }
+
+        void setAncho(int l, int a) {
+            if (l > 0) {
+                anchos[l - 1] = a;
+            }
         }
     };
 
-    // Puntero al primer nodo de la lista
-    Nodo* first;
+    // Nodo centinela antes del primero: tiene todos los niveles del indice
+    Nodo* cabeza;
     // Puntero al último nodo de la lista
     Nodo* last;
     // Número de elementos en la lista
     int size;
+    // Niveles permitidos: 1 en modo simple, MAX_NIVELES con indice
+    int nivelMaximo;
+    // Niveles usados ahora mismo por algun nodo
+    int nivelesUsados;
+    // Estado del generador de alturas de los nodos
+    unsigned int semilla;
+
+    // Altura aleatoria de un nodo nuevo: 1 con prob. 1/2, 2 con 1/4...
+    int alturaAleatoria() {
+        int h = 1;
+        while (h < nivelMaximo) {
+            semilla ^= semilla << 13;
+            semilla ^= semilla >> 17;
+            semilla ^= semilla << 5;
+            if ((semilla & 1u) == 0) {
+                return h;
+            }
+            h = h + 1;
+        }
+        return h;
+    }
+
+    // Busca el nodo de la posición "rango" (1 = primer elemento, 0 = cabeza).
+    // Si anteriores no es nulo, deja en anteriores[l] el último nodo del
+    // nivel l antes de la posición rango + 1 y en rangos[l] su posición.
+    Nodo* buscarRango(int rango, Nodo** anteriores, int* rangos) {
+        Nodo* x = cabeza;
+        int r = 0;
+
+        for (int l = nivelesUsados - 1; l >= 0; l--) {
+            while (x->sig(l) != nullptr && r + x->ancho(l) <= rango) {
+                r = r + x->ancho(l);
+                x = x->sig(l);
+            }
+            if (anteriores != nullptr) {
+                anteriores[l] = x;
+                rangos[l] = r;
+            }
+        }
+
+        return x;
+    }
 
 public:
-    // Constructor: crea una lista vacía
-    LinkedList() {
-        first = nullptr;
+    // Constructor: crea una lista vacía. Con indicePosicional = true
+    // mantiene el indice para acceder por posicion en O(log n).
+    LinkedList(bool indicePosicional = false) {
+        nivelMaximo = indicePosicional ? MAX_NIVELES : 1;
+        cabeza = new Nodo();
+        cabeza->crearNiveles(nivelMaximo);
         last = nullptr;
         size = 0;
+        nivelesUsados = 1;
+        semilla = 2463534242u;
     }
 
     // Destructor: libera todos los nodos
     ~LinkedList() {
         limpiar();
+        delete cabeza;
     }
 
+    // No se permite copiar: dos listas propietarias liberarian lo mismo
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
     // Indica si la lista está vacía
     bool estaVacia() {
         return size == 0;
@@ -81,64 +251,61 @@ public:
 
     // Inserta un elemento al principio de la lista
     void insertar_cabeza(T e) {
-        Nodo* nodo = new Nodo(e);
-
-        if (first == nullptr) {
-            // Lista vacía: el nuevo nodo es primero y último
-            first = nodo;
-            last = nodo;
-        } else {
-            // Lista no vacía: insertamos delante del primero
-            nodo->next = first;
-            first = nodo;
-        }
-
-        size = size + 1;
+        insert_at(e, 0);
     }
 
     // Inserta un elemento al final de la lista
     void insertar_cola(T e) {
-        Nodo* nodo = new Nodo(e);
-
-        if (first == nullptr) {
-            // Lista vacía: el nuevo nodo es primero y último
-            first = nodo;
-            last = nodo;
-        } else {
-            // Lista no vacía: insertamos detrás del último
-            last->next = nodo;
-            last = nodo;
-        }
-
-        size = size + 1;
+        insert_at(e, size);
     }
 
     // Inserta un elemento en la posición pos
     void insert_at(T e, int pos) {
         if (pos >= 0 && pos <= size) {
-            if (pos == 0) {
-                // Insertar al principio
-                insertar_cabeza(e);
-            } else {
-                if (pos == size) {
-                    // Insertar al final
-                    insertar_cola(e);
+            Nodo* nodo = new Nodo(e);
+            int h = alturaAleatoria();
+            nodo->crearNiveles(h);
+
+            if (h == 1 && pos == size) {
+                // Al final y sin niveles de indice: basta con enlazar tras el último
+                if (last == nullptr) {
+                    cabeza->next = nodo;
                 } else {
-                    // Insertar en posición intermedia
-                    Nodo* nodo = new Nodo(e);
-                    Nodo* index = first;
-                    int i = 0;
-                    // Avanzamos hasta el nodo anterior a "pos"
-                    while (i < pos - 1) {
-                        index = index->next;
-                        i = i + 1;
+                    last->next = nodo;
+                }
+            } else {
+                Nodo* anteriores[MAX_NIVELES];
+                int rangos[MAX_NIVELES];
+                buscarRango(pos, anteriores, rangos);
+
+                // Niveles nuevos: de momento solo los tiene la cabeza
+                while (nivelesUsados < h) {
+                    anteriores[nivelesUsados] = cabeza;
+                    rangos[nivelesUsados] = 0;
+                    nivelesUsados = nivelesUsados + 1;
+                }
+
+                for (int l = 0; l < nivelesUsados; l++) {
+                    Nodo* antes = anteriores[l];
+                    if (l < h) {
+                        // Enlazamos el nodo en este nivel y repartimos el ancho
+                        nodo->setSig(l, antes->sig(l));
+                        if (nodo->sig(l) != nullptr) {
+                            nodo->setAncho(l, rangos[l] + antes->ancho(l) - pos);
+                        }
+                        antes->setSig(l, nodo);
+                        antes->setAncho(l, pos + 1 - rangos[l]);
+                    } else if (antes->sig(l) != nullptr) {
+                        // El salto que pasa por encima ahora avanza uno más
+                        antes->setAncho(l, antes->ancho(l) + 1);
                     }
-                    // Ajustamos punteros para insertar en medio
-                    nodo->next = index->next;
-                    index->next = nodo;
-                    size = size + 1;
                 }
             }
+
+            if (nodo->next == nullptr) {
+                last = nodo;
+            }
+            size = size + 1;
         } else {
             std::cout << "No se puede insertar. Posicion no disponible" << std::endl;
         }
@@ -146,65 +313,26 @@ public:
 
     // Extrae (elimina) el primer elemento y lo devuelve
     T extraer_cabeza() {
-        if (first == nullptr) {
+        if (size == 0) {
             std::cout << "Lista vacia, no se puede extraer" << std::endl;
             return T();
         }
-
-        // Guardamos el nodo a borrar y el dato
-        Nodo* n_aux = first;
-        T aux = n_aux->data;
-
-        // Avanzamos el primer nodo
-        first = n_aux->next;
-
-        // Si ya no quedan nodos, actualizamos last
-        if (first == nullptr) {
-            last = nullptr;
-        }
-
-        // Borramos el nodo
-        delete n_aux;
-        size = size - 1;
-
-        return aux;
+        return extract_at(0);
     }
 
     // Extrae (elimina) el último elemento y lo devuelve
     T extraer_cola() {
-        if (first == nullptr) {
+        if (size == 0) {
             std::cout << "Lista vacia, no se puede extraer" << std::endl;
             return T();
         }
-
-        // Caso de un solo elemento
-        if (first == last) {
-            T aux = first->data;
-            delete first;
-            first = nullptr;
-            last = nullptr;
-            size = 0;
-            return aux;
-        }
-
-        // Caso general: buscamos el nodo anterior al último
-        Nodo* anterior = first;
-        while (anterior->next != last) {
-            anterior = anterior->next;
-        }
-
-        T aux = last->data;
-        delete last;
-        last = anterior;
-        last->next = nullptr;
-        size = size - 1;
-
-        return aux;
+        return extract_at(size - 1);
     }
 
-    // Extrae y devuelve el elemento de la posición pos
+    // Extrae y devuelve el elemento de la posición pos.
+    // En una lista propietaria el llamador pasa a ser dueno del dato.
     T extract_at(int pos) {
-        if (first == nullptr) {
+        if (size == 0) {
             std::cout << "Lista vacia, no se puede extraer" << std::endl;
             return T();
         }
@@ -214,30 +342,33 @@ public:
             return T();
         }
 
-        if (pos == 0) {
-            return extraer_cabeza();
-        }
+        Nodo* anteriores[MAX_NIVELES];
+        int rangos[MAX_NIVELES];
+        buscarRango(pos, anteriores, rangos);
 
-        if (pos == size - 1) {
-            return extraer_cola();
+        // Nodo que queremos borrar
+        Nodo* borrar = anteriores[0]->next;
+
+        for (int l = 0; l < nivelesUsados; l++) {
+            Nodo* antes = anteriores[l];
+            if (antes->sig(l) == borrar) {
+                // Saltamos el nodo a borrar juntando los dos anchos
+                antes->setAncho(l, antes->ancho(l) + borrar->ancho(l) - 1);
+                antes->setSig(l, borrar->sig(l));
+            } else if (antes->sig(l) != nullptr) {
+                antes->setAncho(l, antes->ancho(l) - 1);
+            }
         }
 
-        // Buscamos el nodo anterior al que queremos borrar
-        Nodo* anterior = first;
-        int i = 0;
-        while (i < pos - 1) {
-            anterior = anterior->next;
-            i = i + 1;
+        if (borrar == last) {
+            last = anteriores[0] == cabeza ? nullptr : anteriores[0];
+        }
+        while (nivelesUsados > 1 && cabeza->sig(nivelesUsados - 1) == nullptr) {
+            nivelesUsados = nivelesUsados - 1;
         }
 
-        // Nodo que queremos borrar
-        Nodo* borrar = anterior->next;
         T aux = borrar->data;
-
-        // Saltamos el nodo a borrar
-        anterior->next = borrar->next;
         delete borrar;
-
         size = size - 1;
         return aux;
     }
@@ -249,33 +380,505 @@ public:
             return T();
         }
 
-        Nodo* actual = first;
-        int i = 0;
-        while (i < pos) {
-            actual = actual->next;
-            i = i + 1;
+        return buscarRango(pos + 1, nullptr, nullptr)->data;
+    }
+
+    // Elimina el elemento de la posición pos y lo libera segun la
+    // politica de propiedad (en una lista propietaria, hace delete)
+    void eliminar_en(int pos) {
+        if (pos < 0 || pos >= size) {
+            std::cout << "Posicion no valida" << std::endl;
+            return;
         }
 
-        return actual->data;
+        T aux = extract_at(pos);
+        Propiedad::liberar(aux);
+    }
+
+    // Aplica la funcion f a cada elemento, en orden, en un solo recorrido.
+    // Evita el coste cuadratico de llamar a obtener_en(i) dentro de un bucle.
+    template <typename F>
+    void recorrer(F f) {
+        Nodo* actual = cabeza->next;
+        while (actual != nullptr) {
+            f(actual->data);
+            actual = actual->next;
+        }
     }
 
-    // Elimina todos los nodos de la lista
+    // Elimina todos los nodos de la lista (y sus datos si es propietaria)
     void limpiar() {
-        Nodo* actual = first;
+        Nodo* actual = cabeza->next;
 
         while (actual != nullptr) {
             Nodo* siguiente = actual->next;
+            Propiedad::liberar(actual->data);
             delete actual;
             actual = siguiente;
         }
 
-        first = nullptr;
+        for (int l = 0; l < nivelMaximo; l++) {
+            cabeza->setSig(l, nullptr);
+        }
+        nivelesUsados = 1;
         last = nullptr;
         size = 0;
     }
 };
 
 
+// Funcion hash FNV-1a sobre los caracteres de un texto
+unsigned int hashTexto(const std::string& texto) {
+    unsigned int h = 2166136261u;
+    for (std::size_t i = 0; i < texto.size(); i++) {
+        h = h ^ (unsigned char) texto[i];
+        h = h * 16777619u;
+    }
+    return h;
+}
+
+// Tabla hash de direccionamiento abierto con claves de texto.
+// Se usa para operaciones de conjunto sobre telefonos sin recorrer
+// la lista de contactos una vez por cada elemento buscado.
+template <typename V>
+class TablaHash {
+private:
+    std::string* claves;   // claves almacenadas
+    V* valores;            // valor asociado a cada clave
+    bool* ocupadas;        // indica si la casilla esta en uso
+    int capacidad;         // numero de casillas (siempre potencia de 2)
+    int size;              // numero de claves almacenadas
+
+    // Devuelve la casilla donde esta la clave o donde deberia ir
+    int buscarCasilla(const std::string& clave) {
+        int mascara = capacidad - 1;
+        int i = (int) (hashTexto(clave) & (unsigned int) mascara);
+        while (ocupadas[i] && claves[i] != clave) {
+            i = (i + 1) & mascara;
+        }
+        return i;
+    }
+
+    // Reserva las casillas vacias para una capacidad dada
+    void reservar(int nuevaCapacidad) {
+        capacidad = nuevaCapacidad;
+        claves = new std::string[capacidad];
+        valores = new V[capacidad];
+        ocupadas = new bool[capacidad];
+        for (int i = 0; i < capacidad; i++) {
+            ocupadas[i] = false;
+        }
+    }
+
+    // Duplica la capacidad y recoloca todas las claves
+    void crecer() {
+        std::string* viejasClaves = claves;
+        V* viejosValores = valores;
+        bool* viejasOcupadas = ocupadas;
+        int viejaCapacidad = capacidad;
+
+        reservar(capacidad * 2);
+        for (int i = 0; i < viejaCapacidad; i++) {
+            if (viejasOcupadas[i]) {
+                int j = buscarCasilla(viejasClaves[i]);
+                claves[j].swap(viejasClaves[i]);
+                valores[j] = viejosValores[i];
+                ocupadas[j] = true;
+            }
+        }
+
+        delete[] viejasClaves;
+        delete[] viejosValores;
+        delete[] viejasOcupadas;
+    }
+
+public:
+    // Constructor: tabla vacia con capacidad para unos "previstos" elementos
+    TablaHash(int previstos = 8) {
+        int inicial = 16;
+        while (inicial < previstos * 2) {
+            inicial = inicial * 2;
+        }
+        reservar(inicial);
+        size = 0;
+    }
+
+    // Destructor: libera las casillas
+    ~TablaHash() {
+        delete[] claves;
+        delete[] valores;
+        delete[] ocupadas;
+    }
+
+    TablaHash(const TablaHash&) = delete;
+    TablaHash& operator=(const TablaHash&) = delete;
+
+    // Devuelve cuantas claves hay en la tabla
+    int getSize() {
+        return size;
+    }
+
+    // Devuelve el valor de la clave o nullptr si no esta
+    V* buscar(const std::string& clave) {
+        int i = buscarCasilla(clave);
+        if (ocupadas[i]) {
+            return &valores[i];
+        }
+        return nullptr;
+    }
+
+    // Devuelve el valor de la clave, insertandola con V() si no estaba
+    V* insertar(const std::string& clave) {
+        // Mantenemos el factor de carga por debajo de 1/2
+        if ((size + 1) * 2 > capacidad) {
+            crecer();
+        }
+
+        int i = buscarCasilla(clave);
+        if (!ocupadas[i]) {
+            claves[i] = clave;
+            valores[i] = V();
+            ocupadas[i] = true;
+            size = size + 1;
+        }
+        return &valores[i];
+    }
+
+    // Quita una clave de la tabla. Devuelve false si no estaba.
+    // Si el valor tiene memoria propia, el llamador debe liberarla antes.
+    bool eliminar(const std::string& clave) {
+        int i = buscarCasilla(clave);
+        if (!ocupadas[i]) {
+            return false;
+        }
+
+        ocupadas[i] = false;
+        claves[i].clear();
+        size = size - 1;
+
+        // Recolocamos las claves siguientes que ya no se encontrarian
+        // por culpa del hueco (borrado con desplazamiento hacia atras)
+        int mascara = capacidad - 1;
+        int j = i;
+        while (true) {
+            j = (j + 1) & mascara;
+            if (!ocupadas[j]) {
+                return true;
+            }
+
+            int ideal = (int) (hashTexto(claves[j]) & (unsigned int) mascara);
+            bool enSuSitio;
+            if (i <= j) {
+                enSuSitio = i < ideal && ideal <= j;
+            } else {
+                enSuSitio = i < ideal || ideal <= j;
+            }
+
+            if (!enSuSitio) {
+                claves[i].swap(claves[j]);
+                valores[i] = valores[j];
+                ocupadas[i] = true;
+                ocupadas[j] = false;
+                i = j;
+            }
+        }
+    }
+
+    // Aplica f(clave, valor) a cada entrada de la tabla
+    template <typename F>
+    void recorrer(F f) {
+        for (int i = 0; i < capacidad; i++) {
+            if (ocupadas[i]) {
+                f(claves[i], valores[i]);
+            }
+        }
+    }
+};
+
+
+// Lista persistente de punteros a T.
+// Los nodos son inmutables y forman un arbol AVL ordenado por posicion.
+// Cada escritura crea una nueva version copiando solo el camino desde la
+// raiz hasta la posicion tocada (O(log n) nodos) y comparte el resto con
+// la version anterior. Una instantanea es solo una copia de la raiz, asi
+// que cuesta O(1) y sigue viendo siempre los mismos datos aunque la lista
+// original se modifique despues.
+// La lista es duena de los elementos: se liberan cuando ninguna version
+// (ni la actual ni ninguna instantanea) los usa ya.
+// Las escrituras y las lecturas directas de la lista deben hacerse desde el
+// hilo que la escribe. Otros hilos piden una instantanea (una lectura
+// atomica de la raiz) y leen sobre ella sin ninguna sincronizacion mas.
+template <typename T>
+class ListaPersistente {
+private:
+    // Clase interna Nodo: un nodo inmutable del arbol
+    class Nodo {
+    public:
+        std::shared_ptr<const T> dato;     // elemento de esta posicion
+        std::shared_ptr<const Nodo> izq;   // elementos anteriores
+        std::shared_ptr<const Nodo> der;   // elementos posteriores
+        int altura;                        // altura del subarbol
+        int tam;                           // numero de elementos del subarbol
+    };
+
+    // Raiz de la version actual
+    std::shared_ptr<const Nodo> raiz;
+
+    static int tamDe(const std::shared_ptr<const Nodo>& n) {
+        if (n == nullptr) {
+            return 0;
+        }
+        return n->tam;
+    }
+
+    static int alturaDe(const std::shared_ptr<const Nodo>& n) {
+        if (n == nullptr) {
+            return 0;
+        }
+        return n->altura;
+    }
+
+    // Crea un nodo nuevo a partir de su dato y sus dos hijos
+    static std::shared_ptr<const Nodo> crear(const std::shared_ptr<const T>& dato,
+                                             const std::shared_ptr<const Nodo>& izq,
+                                             const std::shared_ptr<const Nodo>& der) {
+        std::shared_ptr<Nodo> nodo = std::make_shared<Nodo>();
+        nodo->dato = dato;
+        nodo->izq = izq;
+        nodo->der = der;
+        int ai = alturaDe(izq);
+        int ad = alturaDe(der);
+        nodo->altura = (ai > ad ? ai : ad) + 1;
+        nodo->tam = tamDe(izq) + tamDe(der) + 1;
+        return nodo;
+    }
+
+    // Crea un nodo equilibrado con rotaciones nuevas si hace falta
+    // (tras una sola insercion o borrado la diferencia de alturas es como mucho 2)
+    static std::shared_ptr<const Nodo> equilibrar(const std::shared_ptr<const T>& dato,
+                                                  const std::shared_ptr<const Nodo>& izq,
+                                                  const std::shared_ptr<const Nodo>& der) {
+        if (alturaDe(izq) > alturaDe(der) + 1) {
+            if (alturaDe(izq->izq) >= alturaDe(izq->der)) {
+                // Rotacion simple a la derecha
+                return crear(izq->dato, izq->izq, crear(dato, izq->der, der));
+            }
+            // Rotacion doble izquierda-derecha
+            const std::shared_ptr<const Nodo>& medio = izq->der;
+            return crear(medio->dato,
+                         crear(izq->dato, izq->izq, medio->izq),
+                         crear(dato, medio->der, der));
+        }
+
+        if (alturaDe(der) > alturaDe(izq) + 1) {
+            if (alturaDe(der->der) >= alturaDe(der->izq)) {
+                // Rotacion simple a la izquierda
+                return crear(der->dato, crear(dato, izq, der->izq), der->der);
+            }
+            // Rotacion doble derecha-izquierda
+            const std::shared_ptr<const Nodo>& medio = der->izq;
+            return crear(medio->dato,
+                         crear(dato, izq, medio->izq),
+                         crear(der->dato, medio->der, der->der));
+        }
+
+        return crear(dato, izq, der);
+    }
+
+    static std::shared_ptr<const Nodo> insertarEn(const std::shared_ptr<const Nodo>& n, int pos,
+                                                  const std::shared_ptr<const T>& dato) {
+        if (n == nullptr) {
+            return crear(dato, nullptr, nullptr);
+        }
+
+        int antes = tamDe(n->izq);
+        if (pos <= antes) {
+            return equilibrar(n->dato, insertarEn(n->izq, pos, dato), n->der);
+        }
+        return equilibrar(n->dato, n->izq, insertarEn(n->der, pos - antes - 1, dato));
+    }
+
+    // Quita el primer elemento del subarbol y lo deja en "primero"
+    static std::shared_ptr<const Nodo> quitarPrimero(const std::shared_ptr<const Nodo>& n,
+                                                     std::shared_ptr<const T>& primero) {
+        if (n->izq == nullptr) {
+            primero = n->dato;
+            return n->der;
+        }
+        return equilibrar(n->dato, quitarPrimero(n->izq, primero), n->der);
+    }
+
+    static std::shared_ptr<const Nodo> eliminarEn(const std::shared_ptr<const Nodo>& n, int pos) {
+        int antes = tamDe(n->izq);
+        if (pos < antes) {
+            return equilibrar(n->dato, eliminarEn(n->izq, pos), n->der);
+        }
+        if (pos > antes) {
+            return equilibrar(n->dato, n->izq, eliminarEn(n->der, pos - antes - 1));
+        }
+
+        // Es este nodo: lo sustituimos por el primero del subarbol derecho
+        if (n->izq == nullptr) {
+            return n->der;
+        }
+        if (n->der == nullptr) {
+            return n->izq;
+        }
+        std::shared_ptr<const T> sucesor;
+        std::shared_ptr<const Nodo> der = quitarPrimero(n->der, sucesor);
+        return equilibrar(sucesor, n->izq, der);
+    }
+
+    static std::shared_ptr<const Nodo> reemplazarEn(const std::shared_ptr<const Nodo>& n, int pos,
+                                                    const std::shared_ptr<const T>& dato) {
+        int antes = tamDe(n->izq);
+        if (pos < antes) {
+            return crear(n->dato, reemplazarEn(n->izq, pos, dato), n->der);
+        }
+        if (pos > antes) {
+            return crear(n->dato, n->izq, reemplazarEn(n->der, pos - antes - 1, dato));
+        }
+        return crear(dato, n->izq, n->der);
+    }
+
+    template <typename F>
+    static void recorrerDesde(const std::shared_ptr<const Nodo>& n, F& f) {
+        if (n != nullptr) {
+            recorrerDesde(n->izq, f);
+            f(n->dato.get());
+            recorrerDesde(n->der, f);
+        }
+    }
+
+    // Para en cuanto f(const T*) devuelve true
+    template <typename F>
+    static bool existeDesde(const std::shared_ptr<const Nodo>& n, F& f) {
+        if (n == nullptr) {
+            return false;
+        }
+        if (existeDesde(n->izq, f)) {
+            return true;
+        }
+        if (f(n->dato.get())) {
+            return true;
+        }
+        return existeDesde(n->der, f);
+    }
+
+    // Publica una nueva version. Es la unica escritura de la raiz que puede
+    // coincidir con una instantanea pedida desde otro hilo, asi que es atomica.
+    void publicar(const std::shared_ptr<const Nodo>& nueva) {
+        std::atomic_store(&raiz, nueva);
+    }
+
+public:
+    // Constructor: crea una lista vacia
+    ListaPersistente() {
+    }
+
+    // Devuelve una instantanea O(1) de la version actual. Es otra lista
+    // independiente: escribir en ella o en la original no afecta a la otra.
+    // La raiz se lee de forma atomica una sola vez aqui; despues la copia es
+    // privada de quien la pidio y sus lecturas no se sincronizan con nadie.
+    ListaPersistente<T> instantanea() const {
+        ListaPersistente<T> copia;
+        copia.raiz = std::atomic_load(&raiz);
+        return copia;
+    }
+
+    // Indica si la lista esta vacia
+    bool estaVacia() const {
+        return raiz == nullptr;
+    }
+
+    // Devuelve cuantos elementos hay en la lista
+    int getSize() const {
+        return tamDe(raiz);
+    }
+
+    // Inserta un elemento al final (la lista pasa a ser duena de e)
+    void insertar_cola(T* e) {
+        publicar(insertarEn(raiz, tamDe(raiz), std::shared_ptr<const T>(e)));
+    }
+
+    // Inserta un elemento en la posicion pos (la lista pasa a ser duena de e)
+    void insert_at(T* e, int pos) {
+        std::shared_ptr<const T> dato(e);
+        const std::shared_ptr<const Nodo>& actual = raiz;
+        if (pos >= 0 && pos <= tamDe(actual)) {
+            publicar(insertarEn(actual, pos, dato));
+        } else {
+            std::cout << "No se puede insertar. Posicion no disponible" << std::endl;
+        }
+    }
+
+    // Elimina el elemento de la posicion pos de la version actual.
+    // Se libera cuando ninguna instantanea lo use.
+    void eliminar_en(int pos) {
+        const std::shared_ptr<const Nodo>& actual = raiz;
+        if (actual == nullptr) {
+            std::cout << "Lista vacia, no se puede extraer" << std::endl;
+            return;
+        }
+        if (pos < 0 || pos >= tamDe(actual)) {
+            std::cout << "Posicion no valida" << std::endl;
+            return;
+        }
+        publicar(eliminarEn(actual, pos));
+    }
+
+    // Sustituye el elemento de la posicion pos por e (la lista pasa a ser duena de e)
+    void reemplazar_en(int pos, T* e) {
+        std::shared_ptr<const T> dato(e);
+        const std::shared_ptr<const Nodo>& actual = raiz;
+        if (pos < 0 || pos >= tamDe(actual)) {
+            std::cout << "Posicion no valida" << std::endl;
+            return;
+        }
+        publicar(reemplazarEn(actual, pos, dato));
+    }
+
+    // Devuelve el elemento de la posicion pos (sin borrar) en O(log n).
+    // El puntero es valido mientras esta version o una instantanea lo contenga.
+    const T* obtener_en(int pos) const {
+        if (pos < 0 || pos >= tamDe(raiz)) {
+            std::cout << "Posicion no valida" << std::endl;
+            return nullptr;
+        }
+
+        const Nodo* n = raiz.get();
+        while (true) {
+            int antes = tamDe(n->izq);
+            if (pos < antes) {
+                n = n->izq.get();
+            } else if (pos > antes) {
+                pos = pos - antes - 1;
+                n = n->der.get();
+            } else {
+                return n->dato.get();
+            }
+        }
+    }
+
+    // Aplica f(const T*) a cada elemento, en orden, sobre la version actual
+    template <typename F>
+    void recorrer(F f) const {
+        recorrerDesde(raiz, f);
+    }
+
+    // Indica si algun elemento cumple f(const T*), parando en el primero
+    template <typename F>
+    bool existe(F f) const {
+        return existeDesde(raiz, f);
+    }
+
+    // Vacia la version actual (las instantaneas conservan sus datos)
+    void limpiar() {
+        publicar(nullptr);
+    }
+};
+
+
 // Clase Contacto: representa un contacto de un perfil
 class Contacto {
 private:
@@ -305,7 +908,7 @@ public:
     }
 
     // Getters y setters básicos
-    std::string getNombre() {
+    const std::string& getNombre() const {
         return nombre;
     }
 
@@ -313,7 +916,7 @@ public:
         nombre = n;
     }
 
-    std::string getTelefono() {
+    const std::string& getTelefono() const {
         return telefono;
     }
 
@@ -321,7 +924,7 @@ public:
         telefono = t;
     }
 
-    int getEdad() {
+    int getEdad() const {
         return edad;
     }
 
@@ -329,7 +932,7 @@ public:
         edad = e;
     }
 
-    std::string getCiudad() {
+    const std::string& getCiudad() const {
         return ciudad;
     }
 
@@ -337,7 +940,7 @@ public:
         ciudad = c;
     }
 
-    std::string getDescripcion() {
+    const std::string& getDescripcion() const {
         return descripcion;
     }
 
@@ -346,51 +949,686 @@ public:
     }
 };
 
-// Clase Perfil: representa un usuario de la "app"
-// Cada perfil tiene su propia lista enlazada de contactos
-class Perfil {
-private:
-    std::string nombreUsuario;             // nombre del perfil
-    std::string descripcion;               // descripción del perfil
-    LinkedList<Contacto*>* contactos;      // puntero a lista enlazada de contactos
+// ---- Deteccion de contactos parecidos ----
+
+// Digitos de un numero nacional: los prefijos internacionales se ignoran
+const int DIGITOS_TELEFONO_NACIONAL = 9;
+// Digitos finales del telefono usados para agrupar candidatos
+const int DIGITOS_SUFIJO_BLOQUE = 4;
+// Letras iniciales del nombre usadas para agrupar candidatos
+const int LETRAS_PREFIJO_BLOQUE = 3;
+// En bloques mas grandes que esto (nombres o sufijos muy comunes) no se
+// comparan todas las parejas: se ordena por la clave del bloque y cada
+// contacto se compara solo con sus VENTANA_BLOQUE_GRANDE vecinos siguientes
+const int TAMANO_MAXIMO_BLOQUE = 64;
+const int VENTANA_BLOQUE_GRANDE = 16;
+
+// Pasa un texto a minusculas sin tildes ni signos, con un solo espacio
+// entre palabras ("Lucía  Pérez" -> "lucia perez"). Entiende UTF-8 latino.
+std::string normalizarTexto(const std::string& texto) {
+    // Letra base de los caracteres UTF-8 0xC3 0x80..0xBF (' ' = separador)
+    static const char* sinTilde =
+        "aaaaaaaceeeeiiii" "dnooooo ouuuuyts"
+        "aaaaaaaceeeeiiii" "dnooooo ouuuuyty";
+
+    std::string r;
+    r.reserve(texto.size());
+    bool espacio = false;
+
+    for (std::size_t i = 0; i < texto.size(); i++) {
+        unsigned char ch = (unsigned char) texto[i];
+        char letra = ' ';
+
+        if (ch >= 'A' && ch <= 'Z') {
+            letra = (char) (ch - 'A' + 'a');
+        } else if ((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9')) {
+            letra = (char) ch;
+        } else if (ch == 0xC3 && i + 1 < texto.size()
+                   && ((unsigned char) texto[i + 1] & 0xC0) == 0x80) {
+            letra = sinTilde[(unsigned char) texto[i + 1] - 0x80];
+            i = i + 1;
+        }
 
-public:
-    // Constructor por defecto
-    Perfil() {
-        nombreUsuario = "";
-        descripcion = "";
-        // Creamos la lista de contactos
-        contactos = new LinkedList<Contacto*>();
+        if (letra == ' ') {
+            espacio = !r.empty();
+        } else {
+            if (espacio) {
+                r += ' ';
+                espacio = false;
+            }
+            r += letra;
+        }
+    }
+
+    return r;
+}
+
+// Deja solo los digitos del telefono y, si hay prefijo internacional,
+// los ultimos DIGITOS_TELEFONO_NACIONAL ("+34 611-22 33 44" -> "611223344")
+std::string normalizarTelefono(const std::string& telefono) {
+    std::string r;
+    r.reserve(telefono.size());
+
+    for (std::size_t i = 0; i < telefono.size(); i++) {
+        if (telefono[i] >= '0' && telefono[i] <= '9') {
+            r += telefono[i];
+        }
+    }
+
+    if ((int) r.size() > DIGITOS_TELEFONO_NACIONAL) {
+        r = r.substr(r.size() - DIGITOS_TELEFONO_NACIONAL);
+    }
+    return r;
+}
+
+// Forma exacta del telefono: todos sus digitos, con el prefijo de pais.
+// Un "+" inicial equivale a "00" ("+44 7700 900123" -> "00447700900123"),
+// asi que numeros de paises distintos nunca coinciden.
+std::string telefonoCanonico(const std::string& telefono) {
+    std::string r;
+    r.reserve(telefono.size() + 1);
+
+    std::size_t i = telefono.find_first_not_of(" \t");
+    if (i != std::string::npos && telefono[i] == '+') {
+        r = "00";
+    }
+    for (; i < telefono.size(); i++) {
+        if (telefono[i] >= '0' && telefono[i] <= '9') {
+            r += telefono[i];
+        }
+    }
+
+    // Un "+" sin digitos no es un telefono
+    if (r == "00" && telefono.find_first_of("0123456789") == std::string::npos) {
+        r.clear();
+    }
+    return r;
+}
+
+// Distancia de edicion con la tabla completa (para textos de mas de 64 letras)
+int distanciaEdicionTabla(const std::string& a, const std::string& b) {
+    int n = (int) a.size();
+    int m = (int) b.size();
+    int* anterior = new int[m + 1];
+    int* actual = new int[m + 1];
+
+    for (int j = 0; j <= m; j++) {
+        anterior[j] = j;
+    }
+
+    for (int i = 1; i <= n; i++) {
+        actual[0] = i;
+        for (int j = 1; j <= m; j++) {
+            int coste = anterior[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            int borrar = anterior[j] + 1;
+            int insertar = actual[j - 1] + 1;
+            int mejor = coste < borrar ? coste : borrar;
+            actual[j] = mejor < insertar ? mejor : insertar;
+        }
+        int* aux = anterior;
+        anterior = actual;
+        actual = aux;
+    }
+
+    int d = anterior[m];
+    delete[] anterior;
+    delete[] actual;
+    return d;
+}
+
+// Distancia de edicion (Levenshtein) con el algoritmo de bits de Myers:
+// cada columna de la tabla se calcula de golpe en una palabra de 64 bits,
+// asi que el coste es O(longitud) en lugar de O(longitud^2)
+int distanciaEdicion(const std::string& a, const std::string& b) {
+    // El patron (la columna) es el texto mas corto
+    const std::string& patron = a.size() <= b.size() ? a : b;
+    const std::string& texto = a.size() <= b.size() ? b : a;
+    int m = (int) patron.size();
+
+    if (m == 0) {
+        return (int) texto.size();
+    }
+    if (m > 64) {
+        return distanciaEdicionTabla(a, b);
+    }
+
+    // peq[c]: bits de las posiciones del patron donde aparece c.
+    // Solo se ponen a cero las casillas que se van a leer.
+    unsigned long long peq[256];
+    for (int i = 0; i < m; i++) {
+        peq[(unsigned char) patron[i]] = 0;
+    }
+    for (std::size_t j = 0; j < texto.size(); j++) {
+        peq[(unsigned char) texto[j]] = 0;
+    }
+    for (int i = 0; i < m; i++) {
+        peq[(unsigned char) patron[i]] |= 1ULL << i;
+    }
+
+    unsigned long long pv = ~0ULL;       // diferencias verticales +1
+    unsigned long long mv = 0;           // diferencias verticales -1
+    unsigned long long ultimo = 1ULL << (m - 1);
+    int distancia = m;
+
+    for (std::size_t j = 0; j < texto.size(); j++) {
+        unsigned long long eq = peq[(unsigned char) texto[j]];
+        unsigned long long xv = eq | mv;
+        unsigned long long xh = (((eq & pv) + pv) ^ pv) | eq;
+        unsigned long long ph = mv | ~(xh | pv);
+        unsigned long long mh = pv & xh;
+
+        if (ph & ultimo) {
+            distancia = distancia + 1;
+        } else if (mh & ultimo) {
+            distancia = distancia - 1;
+        }
+
+        ph = (ph << 1) | 1ULL;
+        mh = mh << 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return distancia;
+}
+
+// Similitud entre 0 y 1 a partir de la distancia de edicion
+double similitudTexto(const std::string& a, const std::string& b) {
+    std::size_t mayor = a.size() > b.size() ? a.size() : b.size();
+    if (mayor == 0) {
+        return 1.0;
+    }
+    return 1.0 - (double) distanciaEdicion(a, b) / (double) mayor;
+}
+
+// Agrupa n elementos por clave. Deja en bloqueDe[i] el bloque de cada
+// elemento y en miembros[inicio[b] .. inicio[b+1]) los elementos del bloque b.
+// Devuelve el numero de bloques. El llamador borra inicio y miembros.
+int agruparEnBloques(std::string* claves, int n, int* bloqueDe, int*& inicio, int*& miembros) {
+    TablaHash<int> ids(n);
+    int numBloques = 0;
+
+    for (int i = 0; i < n; i++) {
+        int* id = ids.buscar(claves[i]);
+        if (id == nullptr) {
+            id = ids.insertar(claves[i]);
+            *id = numBloques;
+            numBloques = numBloques + 1;
+        }
+        bloqueDe[i] = *id;
+    }
+
+    // Ordenacion por cuentas: tamano de cada bloque y posicion de inicio
+    inicio = new int[numBloques + 1];
+    for (int b = 0; b <= numBloques; b++) {
+        inicio[b] = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        inicio[bloqueDe[i] + 1] = inicio[bloqueDe[i] + 1] + 1;
+    }
+    for (int b = 0; b < numBloques; b++) {
+        inicio[b + 1] = inicio[b + 1] + inicio[b];
+    }
+
+    int* siguiente = new int[numBloques];
+    for (int b = 0; b < numBloques; b++) {
+        siguiente[b] = inicio[b];
+    }
+    miembros = new int[n];
+    for (int i = 0; i < n; i++) {
+        miembros[siguiente[bloqueDe[i]]] = i;
+        siguiente[bloqueDe[i]] = siguiente[bloqueDe[i]] + 1;
+    }
+    delete[] siguiente;
+
+    return numBloques;
+}
+
+// Busca contactos parecidos en una instantanea de contactos.
+// Las parejas con el mismo telefono normalizado se agrupan aparte y se
+// informan siempre, todas. El resto solo se compara si comparte bloque:
+//   - mismo prefijo de nombre normalizado y misma ciudad, o
+//   - mismos ultimos digitos de telefono.
+// En esos bloques, si son grandes, solo se comparan vecinos (por nombre o
+// por telefono), asi que el coste es casi lineal en el numero de contactos.
+// Una pareja sin el mismo telefono es parecida si sus nombres tienen
+// similitud >= umbral y viven en la misma ciudad.
+// Llama a informar(a, b, similitud, mismoTelefono) por cada pareja y
+// devuelve cuantas hay.
+template <typename F>
+int buscarContactosParecidos(ListaPersistente<Contacto>& foto, double umbral, F informar) {
+    int n = foto.getSize();
+    if (n < 2) {
+        return 0;
+    }
+
+    const Contacto** lista = new const Contacto*[n];
+    std::string* nombres = new std::string[n];
+    std::string* ciudades = new std::string[n];
+    std::string* telefonos = new std::string[n];
+    std::string* claves = new std::string[n];
+    int* bloqueNombre = new int[n];
+    int* bloqueTelefono = new int[n];
+    int* posicionNombre = new int[n];
+
+    int k = 0;
+    foto.recorrer([&](const Contacto* c) {
+        lista[k] = c;
+        nombres[k] = normalizarTexto(c->getNombre());
+        ciudades[k] = normalizarTexto(c->getCiudad());
+        telefonos[k] = normalizarTelefono(c->getTelefono());
+        k = k + 1;
+    });
+
+    // Bloques por telefono exacto (sin telefono, cada uno va solo).
+    // bloqueTelefono se usa aqui de paso: luego lo rellenan los sufijos.
+    for (int i = 0; i < n; i++) {
+        if (telefonos[i].empty()) {
+            claves[i] = "#" + std::to_string(i);
+        } else {
+            claves[i] = telefonos[i];
+        }
+    }
+    int* inicioExacto;
+    int* miembrosExacto;
+    int numExacto = agruparEnBloques(claves, n, bloqueTelefono, inicioExacto, miembrosExacto);
+
+    // Bloques por prefijo de nombre y ciudad
+    for (int i = 0; i < n; i++) {
+        claves[i] = nombres[i].substr(0, LETRAS_PREFIJO_BLOQUE) + "|" + ciudades[i];
+    }
+    int* inicioNombre;
+    int* miembrosNombre;
+    int numNombre = agruparEnBloques(claves, n, bloqueNombre, inicioNombre, miembrosNombre);
+
+    // Bloques por sufijo de telefono (sin telefono, cada uno va solo)
+    for (int i = 0; i < n; i++) {
+        if (telefonos[i].empty()) {
+            claves[i] = "#" + std::to_string(i);
+        } else {
+            int desde = (int) telefonos[i].size() - DIGITOS_SUFIJO_BLOQUE;
+            claves[i] = telefonos[i].substr(desde > 0 ? desde : 0);
+        }
+    }
+    int* inicioTelefono;
+    int* miembrosTelefono;
+    int numTelefono = agruparEnBloques(claves, n, bloqueTelefono, inicioTelefono, miembrosTelefono);
+
+    int parecidos = 0;
+
+    auto mismoTelefono = [&](int i, int j) {
+        return !telefonos[i].empty() && telefonos[i] == telefonos[j];
+    };
+
+    // Mismo telefono: todas las parejas del bloque, sin ventana
+    for (int b = 0; b < numExacto; b++) {
+        for (int x = inicioExacto[b]; x < inicioExacto[b + 1]; x++) {
+            for (int y = x + 1; y < inicioExacto[b + 1]; y++) {
+                int i = miembrosExacto[x];
+                int j = miembrosExacto[y];
+                informar(lista[i], lista[j], similitudTexto(nombres[i], nombres[j]), true);
+                parecidos = parecidos + 1;
+            }
+        }
+    }
+
+    // Recorre las parejas candidatas de cada bloque. Los bloques grandes se
+    // ordenan por "orden" y solo se comparan vecinos dentro de la ventana.
+    // Con guardarPosicion se apunta la posicion de cada contacto en su
+    // bloque ya ordenado, para saber despues que parejas se compararon.
+    auto recorrerParejas = [&](int numBloques, int* inicio, int* miembros, std::string* orden,
+                               bool guardarPosicion, bool saltarMismoNombre) {
+        for (int b = 0; b < numBloques; b++) {
+            int desde = inicio[b];
+            int hasta = inicio[b + 1];
+            int ventana = hasta - desde;
+
+            if (ventana > TAMANO_MAXIMO_BLOQUE) {
+                std::sort(miembros + desde, miembros + hasta, [&](int i, int j) {
+                    return orden[i] < orden[j];
+                });
+                ventana = VENTANA_BLOQUE_GRANDE;
+            }
+            if (guardarPosicion) {
+                for (int x = desde; x < hasta; x++) {
+                    posicionNombre[miembros[x]] = x - desde;
+                }
+            }
+
+            for (int x = desde; x < hasta; x++) {
+                for (int y = x + 1; y < hasta && y <= x + ventana; y++) {
+                    int i = miembros[x] < miembros[y] ? miembros[x] : miembros[y];
+                    int j = miembros[x] < miembros[y] ? miembros[y] : miembros[x];
+
+                    // Las de mismo telefono ya se informaron arriba
+                    if (mismoTelefono(i, j)) {
+                        continue;
+                    }
+                    // Si comparten bloque de nombre, solo se saltan si alli
+                    // se llegaron a comparar (bloque completo o en ventana)
+                    if (saltarMismoNombre && bloqueNombre[i] == bloqueNombre[j]) {
+                        int tam = inicioNombre[bloqueNombre[i] + 1] - inicioNombre[bloqueNombre[i]];
+                        int distancia = posicionNombre[i] - posicionNombre[j];
+                        if (distancia < 0) {
+                            distancia = -distancia;
+                        }
+                        if (tam <= TAMANO_MAXIMO_BLOQUE || distancia <= VENTANA_BLOQUE_GRANDE) {
+                            continue;
+                        }
+                    }
+
+                    if (ciudades[i] != ciudades[j]) {
+                        continue;
+                    }
+                    double similitud = similitudTexto(nombres[i], nombres[j]);
+                    if (similitud >= umbral) {
+                        informar(lista[i], lista[j], similitud, false);
+                        parecidos = parecidos + 1;
+                    }
+                }
+            }
+        }
+    };
+
+    recorrerParejas(numNombre, inicioNombre, miembrosNombre, nombres, true, false);
+    recorrerParejas(numTelefono, inicioTelefono, miembrosTelefono, telefonos, false, true);
+
+    delete[] inicioExacto;
+    delete[] miembrosExacto;
+    delete[] inicioNombre;
+    delete[] miembrosNombre;
+    delete[] inicioTelefono;
+    delete[] miembrosTelefono;
+    delete[] lista;
+    delete[] nombres;
+    delete[] ciudades;
+    delete[] telefonos;
+    delete[] claves;
+    delete[] bloqueNombre;
+    delete[] bloqueTelefono;
+    delete[] posicionNombre;
+
+    return parecidos;
+}
+
+
+// ---- Indice inverso de telefonos ----
+
+class Perfil;
+
+// Perfiles que tienen un telefono, cada uno una sola vez y sin orden.
+// Casi todos los telefonos estan en un solo perfil, asi que el primero se
+// guarda dentro de la propia estructura y solo el resto usa un array.
+// Cada perfil ocupa un hueco: el 0 es el primero y h > 0 es resto[h - 1].
+// Se copia por valor dentro de TablaHash: la memoria se libera con liberar().
+struct PerfilesDeTelefono {
+    Perfil* primero;       // primer perfil (nullptr si no hay ninguno)
+    Perfil** resto;        // resto de perfiles
+    int numResto;
+    int capacidadResto;
+
+    // Numero de perfiles distintos con el telefono
+    int getSize() const {
+        return (primero != nullptr ? 1 : 0) + numResto;
+    }
+
+    // Perfil del hueco h
+    Perfil* enHueco(int h) const {
+        return h == 0 ? primero : resto[h - 1];
+    }
+
+    // Anade el perfil p (que no debe estar ya) y devuelve su hueco
+    int agregar(Perfil* p) {
+        if (primero == nullptr) {
+            primero = p;
+            return 0;
+        }
+
+        if (numResto == capacidadResto) {
+            int nuevaCapacidad = capacidadResto == 0 ? 2 : capacidadResto * 2;
+            Perfil** nuevosPerfiles = new Perfil*[nuevaCapacidad];
+            for (int i = 0; i < numResto; i++) {
+                nuevosPerfiles[i] = resto[i];
+            }
+            delete[] resto;
+            resto = nuevosPerfiles;
+            capacidadResto = nuevaCapacidad;
+        }
+        resto[numResto] = p;
+        numResto = numResto + 1;
+        return numResto;
+    }
+
+    // Quita el perfil del hueco h llevando el ultimo a su sitio. Devuelve
+    // el perfil que ha cambiado de hueco (ahora en h) o nullptr si ninguno.
+    Perfil* quitarEn(int h) {
+        int ultimo = getSize() - 1;
+        Perfil* movido = nullptr;
+
+        if (h != ultimo) {
+            movido = enHueco(ultimo);
+            if (h == 0) {
+                primero = movido;
+            } else {
+                resto[h - 1] = movido;
+            }
+        }
+        if (ultimo == 0) {
+            primero = nullptr;
+        } else {
+            numResto = numResto - 1;
+        }
+        return movido;
+    }
+
+    // Aplica f(Perfil*) a cada perfil que tiene el telefono
+    template <typename F>
+    void recorrer(F& f) const {
+        if (primero != nullptr) {
+            f(primero);
+        }
+        for (int i = 0; i < numResto; i++) {
+            f(resto[i]);
+        }
+    }
+
+    // Libera el array del resto
+    void liberar() {
+        delete[] resto;
+        resto = nullptr;
+        numResto = 0;
+        capacidadResto = 0;
+    }
+};
+
+// Cuantas veces tiene un perfil un telefono y en que hueco de
+// PerfilesDeTelefono esta
+struct AparicionesTelefono {
+    int veces;
+    int hueco;
+};
+
+// Indice global telefono -> perfiles que lo tienen en su agenda.
+// Los perfiles lo mantienen al dia al anadir, modificar o borrar contactos
+// (y por tanto al importar y exportar), asi que saber que perfiles tienen
+// un telefono cuesta O(1 + resultados) en lugar de recorrer todos.
+// Los telefonos se guardan en su forma exacta (telefonoCanonico): da igual
+// como esten escritos, pero "+34 611223344" y "611223344" son distintos.
+// Las veces que cada perfil tiene cada telefono se guardan aparte, por
+// pareja (telefono, perfil), junto con su hueco en la lista de perfiles:
+// anadir o quitar cuesta O(1) aunque el telefono este en miles de perfiles,
+// y la lista solo se toca cuando un perfil gana o pierde el telefono.
+// Esta repartido en partes con su propio cerrojo para que los hilos de
+// carga del almacen puedan indexar a la vez.
+class IndiceTelefonos {
+private:
+    static const int NUM_PARTES = 16;
+
+    // Por parte: telefono -> perfiles y (telefono, perfil) -> apariciones.
+    // Las dos parejas de un telefono caen en la misma parte.
+    TablaHash<PerfilesDeTelefono>* partes[NUM_PARTES];
+    TablaHash<AparicionesTelefono>* apariciones[NUM_PARTES];
+    std::mutex cerrojos[NUM_PARTES];
+
+    // Clave de la pareja (telefono, perfil)
+    static std::string claveAparicion(const std::string& clave, Perfil* p) {
+        return clave + "@" + std::to_string(reinterpret_cast<std::uintptr_t>(p));
+    }
+
+    // Parte de un telefono: bits altos del hash (la tabla usa los bajos)
+    static int parteDe(const std::string& clave) {
+        return (int) ((hashTexto(clave) >> 24) % NUM_PARTES);
+    }
+
+public:
+    IndiceTelefonos() {
+        for (int i = 0; i < NUM_PARTES; i++) {
+            partes[i] = new TablaHash<PerfilesDeTelefono>();
+            apariciones[i] = new TablaHash<AparicionesTelefono>();
+        }
+    }
+
+    ~IndiceTelefonos() {
+        for (int i = 0; i < NUM_PARTES; i++) {
+            partes[i]->recorrer([](const std::string&, PerfilesDeTelefono& perfiles) {
+                perfiles.liberar();
+            });
+            delete partes[i];
+            delete apariciones[i];
+        }
+    }
+
+    IndiceTelefonos(const IndiceTelefonos&) = delete;
+    IndiceTelefonos& operator=(const IndiceTelefonos&) = delete;
+
+    // Anota que el perfil p tiene (una vez mas) el telefono
+    void agregar(const std::string& telefono, Perfil* p) {
+        std::string clave = telefonoCanonico(telefono);
+        if (clave.empty()) {
+            return;
+        }
+
+        std::string par = claveAparicion(clave, p);
+        int k = parteDe(clave);
+        std::lock_guard<std::mutex> guarda(cerrojos[k]);
+
+        AparicionesTelefono* a = apariciones[k]->buscar(par);
+        if (a != nullptr) {
+            a->veces = a->veces + 1;
+            return;
+        }
+        int hueco = partes[k]->insertar(clave)->agregar(p);
+        a = apariciones[k]->insertar(par);
+        a->veces = 1;
+        a->hueco = hueco;
+    }
+
+    // Anota que el perfil p tiene una vez menos el telefono
+    void quitar(const std::string& telefono, Perfil* p) {
+        std::string clave = telefonoCanonico(telefono);
+        if (clave.empty()) {
+            return;
+        }
+
+        std::string par = claveAparicion(clave, p);
+        int k = parteDe(clave);
+        std::lock_guard<std::mutex> guarda(cerrojos[k]);
+
+        AparicionesTelefono* a = apariciones[k]->buscar(par);
+        if (a == nullptr) {
+            return;
+        }
+        a->veces = a->veces - 1;
+        if (a->veces > 0) {
+            return;
+        }
+
+        // El perfil ya no tiene el telefono: sale de la lista
+        int hueco = a->hueco;
+        apariciones[k]->eliminar(par);
+        PerfilesDeTelefono* perfiles = partes[k]->buscar(clave);
+        Perfil* movido = perfiles->quitarEn(hueco);
+        if (movido != nullptr) {
+            apariciones[k]->buscar(claveAparicion(clave, movido))->hueco = hueco;
+        }
+        if (perfiles->getSize() == 0) {
+            perfiles->liberar();
+            partes[k]->eliminar(clave);
+        }
+    }
+
+    // Aplica f(Perfil*) a cada perfil que tiene el telefono y devuelve
+    // cuantos son. f no debe modificar contactos (la parte esta bloqueada).
+    template <typename F>
+    int recorrerPerfilesCon(const std::string& telefono, F f) {
+        std::string clave = telefonoCanonico(telefono);
+        if (clave.empty()) {
+            return 0;
+        }
+
+        int k = parteDe(clave);
+        std::lock_guard<std::mutex> guarda(cerrojos[k]);
+        PerfilesDeTelefono* perfiles = partes[k]->buscar(clave);
+        if (perfiles == nullptr) {
+            return 0;
+        }
+        perfiles->recorrer(f);
+        return perfiles->getSize();
+    }
+
+    // Numero de telefonos distintos indexados
+    int getNumTelefonos() {
+        int total = 0;
+        for (int i = 0; i < NUM_PARTES; i++) {
+            std::lock_guard<std::mutex> guarda(cerrojos[i]);
+            total = total + partes[i]->getSize();
+        }
+        return total;
+    }
+};
+
+
+// Clase Perfil: representa un usuario de la "app"
+// Cada perfil tiene su propia lista enlazada de contactos
+class Perfil {
+private:
+    std::string nombreUsuario;             // nombre del perfil
+    std::string descripcion;               // descripción del perfil
+    // Lista persistente: cada cambio crea una nueva version y las lecturas
+    // largas trabajan sobre una instantanea sin copiar la lista
+    ListaPersistente<Contacto>* contactos;
+    // Índice global de teléfonos (nullptr si el perfil no está en un almacén)
+    IndiceTelefonos* indice;
+
+public:
+    // Constructor por defecto
+    Perfil() {
+        nombreUsuario = "";
+        descripcion = "";
+        // Creamos la lista de contactos
+        contactos = new ListaPersistente<Contacto>();
+        indice = nullptr;
     }
 
     // Constructor con parámetros
     Perfil(std::string nombre, std::string texto) {
         nombreUsuario = nombre;
         descripcion = texto;
-        contactos = new LinkedList<Contacto*>();
+        contactos = new ListaPersistente<Contacto>();
+        indice = nullptr;
     }
 
-    // Destructor: podría liberar contactos y lista.
+    // Destructor: la lista es duena de los contactos, asi que al borrarla se
+    // liberan los que no esten retenidos por alguna instantanea
     ~Perfil() {
-        if (contactos != nullptr) {
-            int total = contactos->getSize();
-            int i = 0;
-            // Borramos cada Contacto* almacenado en la lista
-            while (i < total) {
-                Contacto* c = contactos->obtener_en(i);
-                if (c != nullptr) {
-                    delete c;
-                }
-                i = i + 1;
-            }
-            // Vaciamos nodos de la lista
-            contactos->limpiar();
-            // Borramos la propia lista
-            delete contactos;
-            contactos = nullptr;
-        }
+        setIndice(nullptr);
+        delete contactos;
+        contactos = nullptr;
     }
 
+    Perfil(const Perfil&) = delete;
+    Perfil& operator=(const Perfil&) = delete;
+
     // Getters y setters del perfil
     std::string getNombreUsuario() {
         return nombreUsuario;
@@ -413,45 +1651,87 @@ public:
         return contactos->getSize();
     }
 
-    // Devuelve el puntero al contacto en una posición
-    Contacto* getContactoEn(int posicion) {
-        Contacto* puntero = contactos->obtener_en(posicion);
-        return puntero;
+    // Devuelve el puntero al contacto en una posición (solo lectura).
+    // Para cambiarlo se usa modificarContactoEn.
+    const Contacto* getContactoEn(int posicion) {
+        return contactos->obtener_en(posicion);
     }
 
-    // Añade un contacto al final de la lista
+    // Conecta el perfil a un índice de teléfonos (o lo desconecta con
+    // nullptr): sus contactos se quitan del índice anterior y se añaden al nuevo
+    void setIndice(IndiceTelefonos* nuevo) {
+        if (nuevo == indice) {
+            return;
+        }
+
+        contactos->recorrer([&](const Contacto* c) {
+            if (indice != nullptr) {
+                indice->quitar(c->getTelefono(), this);
+            }
+            if (nuevo != nullptr) {
+                nuevo->agregar(c->getTelefono(), this);
+            }
+        });
+        indice = nuevo;
+    }
+
+    // Deja de usar el índice sin quitar sus teléfonos (cuando el índice se
+    // va a borrar entero justo después)
+    void soltarIndice() {
+        indice = nullptr;
+    }
+
+    // Añade un contacto al final de la lista (el perfil pasa a ser su dueño)
     void agregarContactoFinal(Contacto* contacto) {
+        if (indice != nullptr) {
+            indice->agregar(contacto->getTelefono(), this);
+        }
         contactos->insertar_cola(contacto);
     }
 
-    // Comprueba si ya existe un contacto con ese teléfono
-    bool existeTelefono(std::string telefono) {
-        int total = contactos->getSize();
-        int i = 0;
-
-        while (i < total) {
-            Contacto* c = contactos->obtener_en(i);
-            if (c != nullptr) {
-                if (c->getTelefono() == telefono) {
-                    return true;
-                }
-            }
-            i = i + 1;
+    // Sustituye el contacto de una posición por uno nuevo
+    void modificarContactoEn(int posicion, Contacto* nuevo) {
+        if (indice != nullptr && posicion >= 0 && posicion < getNumeroContactos()) {
+            indice->quitar(contactos->obtener_en(posicion)->getTelefono(), this);
+            indice->agregar(nuevo->getTelefono(), this);
         }
+        contactos->reemplazar_en(posicion, nuevo);
+    }
 
-        return false;
+    // Devuelve una instantánea O(1) de los contactos: no cambia aunque
+    // el perfil se modifique mientras se recorre
+    ListaPersistente<Contacto> instantaneaContactos() {
+        return contactos->instantanea();
+    }
+
+    // Aplica f a cada contacto del perfil en un solo recorrido,
+    // sobre una instantánea tomada al empezar
+    template <typename F>
+    void recorrerContactos(F f) {
+        ListaPersistente<Contacto> foto = contactos->instantanea();
+        foto.recorrer(f);
+    }
+
+    // Comprueba si ya existe un contacto con ese teléfono
+    bool existeTelefono(std::string telefono) {
+        return contactos->existe([&](const Contacto* c) {
+            return c != nullptr && c->getTelefono() == telefono;
+        });
     }
 
     // Importa contactos desde otro perfil (omito comentarios largos)
     void importarContactosDesde(Perfil* origen) {
         if (origen != nullptr) {
-            int total = origen->getNumeroContactos();
+            // Leemos de una instantánea para que el origen pueda cambiar
+            // (o ser este mismo perfil) sin afectar a la importación
+            ListaPersistente<Contacto> foto = origen->instantaneaContactos();
+            int total = foto.getSize();
             int importados = 0;
             int duplicados = 0;
             int i = 0;
 
             while (i < total) {
-                Contacto* original = origen->getContactoEn(i);
+                const Contacto* original = foto.obtener_en(i);
                 if (original != nullptr) {
                     std::string telefono = original->getTelefono();
                     bool existe = existeTelefono(telefono);
@@ -481,16 +1761,17 @@ public:
 
     // Detecta contactos duplicados por teléfono
     void detectarContactosDuplicados() {
-        int total = contactos->getSize();
+        ListaPersistente<Contacto> foto = contactos->instantanea();
+        int total = foto.getSize();
         bool hayDuplicados = false;
         int i = 0;
 
         while (i < total) {
-            Contacto* primero = contactos->obtener_en(i);
+            const Contacto* primero = foto.obtener_en(i);
             if (primero != nullptr) {
                 int j = i + 1;
                 while (j < total) {
-                    Contacto* segundo = contactos->obtener_en(j);
+                    const Contacto* segundo = foto.obtener_en(j);
                     if (segundo != nullptr) {
                         if (primero->getTelefono() == segundo->getTelefono()) {
                             if (!hayDuplicados) {
@@ -516,17 +1797,291 @@ public:
         }
     }
 
-    // Elimina un contacto por posición y libera memoria
+    // Detecta contactos parecidos aunque no sean idénticos: mismo teléfono
+    // con distinto formato o nombres casi iguales en la misma ciudad
+    // ("Lucia"/"Lucía"). umbral es la similitud mínima entre 0 y 1.
+    void detectarContactosParecidos(double umbral) {
+        ListaPersistente<Contacto> foto = contactos->instantanea();
+
+        int total = buscarContactosParecidos(foto, umbral,
+            [&](const Contacto* a, const Contacto* b, double similitud, bool mismoTelefono) {
+                std::cout << "- " << a->getNombre() << " (" << a->getTelefono() << ")"
+                          << " y " << b->getNombre() << " (" << b->getTelefono() << ")";
+                if (mismoTelefono) {
+                    std::cout << " tienen el mismo telefono" << std::endl;
+                } else {
+                    std::cout << " se parecen un " << (int) (similitud * 100)
+                              << "% en " << a->getCiudad() << std::endl;
+                }
+            });
+
+        if (total == 0) {
+            std::cout << "No hay contactos parecidos en el perfil \""
+                      << nombreUsuario << "\"." << std::endl;
+        } else {
+            std::cout << "Se han encontrado " << total
+                      << " parejas de contactos parecidos." << std::endl;
+        }
+    }
+
+    // Elimina un contacto por posición; se libera cuando ninguna
+    // instantánea lo esté usando
     void eliminarContactoEn(int posicion) {
         if (posicion >= 0 && posicion < getNumeroContactos()) {
-            Contacto* c = contactos->extract_at(posicion);
-            if (c != nullptr) {
-                delete c;
+            if (indice != nullptr) {
+                indice->quitar(contactos->obtener_en(posicion)->getTelefono(), this);
+            }
+            contactos->eliminar_en(posicion);
+        }
+    }
+};
+
+
+// Escritor de ficheros con escritura vectorial (writev).
+// En lugar de copiar cada campo a un buffer, guarda una lista de trozos
+// (puntero + tamano) y los escribe todos con una sola llamada. Los textos
+// cortos y los separadores se copian a un buffer grande reutilizable; los
+// campos largos se escriben directamente desde el contacto, asi que los
+// datos deben seguir vivos hasta el siguiente volcado.
+class EscritorVectorial {
+private:
+    static const int MAX_TROZOS = 256;              // trozos por llamada a writev
+    static const int TAM_BUFFER = 64 * 1024;        // buffer para textos cortos
+    static const std::size_t MINIMO_DIRECTO = 48;   // campos mas largos no se copian
+
+#ifdef _WIN32
+    FILE* fichero;
+#else
+    int fd;
+#endif
+    bool esSalidaEstandar;   // "-" escribe en la salida estandar
+    bool error;              // alguna escritura ha fallado
+
+    char* buffer;            // buffer reutilizable para textos cortos
+    int usado;               // bytes ocupados del buffer
+    iovec* trozos;           // trozos pendientes de escribir
+    int numTrozos;
+
+    // Anade un trozo que apunta a datos externos
+    void agregarTrozo(const char* datos, std::size_t tam) {
+        if (numTrozos == MAX_TROZOS) {
+            volcar();
+        }
+        trozos[numTrozos].iov_base = (void*) datos;
+        trozos[numTrozos].iov_len = tam;
+        numTrozos = numTrozos + 1;
+    }
+
+    // Copia datos al buffer; si continuan el ultimo trozo, lo alarga.
+    // Hace sitio (en el buffer y en la tabla de trozos) antes de copiar:
+    // volcar despues dejaria el trozo nuevo apuntando a un hueco ya reutilizado.
+    void copiarAlBuffer(const char* datos, std::size_t tam) {
+        if (usado + (int) tam > TAM_BUFFER || numTrozos == MAX_TROZOS) {
+            volcar();
+        }
+        if ((int) tam > TAM_BUFFER) {
+            agregarTrozo(datos, tam);
+            return;
+        }
+
+        char* destino = buffer + usado;
+        std::memcpy(destino, datos, tam);
+        usado = usado + (int) tam;
+
+        if (numTrozos > 0 && (char*) trozos[numTrozos - 1].iov_base
+                             + trozos[numTrozos - 1].iov_len == destino) {
+            trozos[numTrozos - 1].iov_len += tam;
+        } else {
+            agregarTrozo(destino, tam);
+        }
+    }
+
+public:
+    // Constructor: escritor sin fichero abierto
+    EscritorVectorial() {
+#ifdef _WIN32
+        fichero = nullptr;
+#else
+        fd = -1;
+#endif
+        esSalidaEstandar = false;
+        error = false;
+        buffer = new char[TAM_BUFFER];
+        usado = 0;
+        trozos = new iovec[MAX_TROZOS];
+        numTrozos = 0;
+    }
+
+    // Destructor: vuelca lo pendiente y cierra el fichero
+    ~EscritorVectorial() {
+        cerrar();
+        delete[] buffer;
+        delete[] trozos;
+    }
+
+    EscritorVectorial(const EscritorVectorial&) = delete;
+    EscritorVectorial& operator=(const EscritorVectorial&) = delete;
+
+    // Abre (o crea) el fichero de salida. "-" es la salida estandar.
+    bool abrir(const std::string& ruta) {
+        cerrar();
+        error = false;
+        esSalidaEstandar = ruta == "-";
+#ifdef _WIN32
+        fichero = esSalidaEstandar ? stdout : std::fopen(ruta.c_str(), "wb");
+        return fichero != nullptr;
+#else
+        if (esSalidaEstandar) {
+            std::cout.flush();
+            fd = 1;
+        } else {
+            fd = ::open(ruta.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        return fd >= 0;
+#endif
+    }
+
+    // Escribe todos los trozos pendientes y deja el buffer libre
+    void volcar() {
+#ifdef _WIN32
+        for (int i = 0; i < numTrozos && fichero != nullptr; i++) {
+            if (std::fwrite(trozos[i].iov_base, 1, trozos[i].iov_len, fichero) != trozos[i].iov_len) {
+                error = true;
+            }
+        }
+        if (fichero != nullptr) {
+            std::fflush(fichero);
+        }
+#else
+        int primero = 0;
+        while (fd >= 0 && primero < numTrozos) {
+            ssize_t escritos = ::writev(fd, trozos + primero, numTrozos - primero);
+            if (escritos < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = true;
+                break;
+            }
+            // Escritura parcial: saltamos los trozos ya escritos
+            std::size_t resto = (std::size_t) escritos;
+            while (primero < numTrozos && resto >= trozos[primero].iov_len) {
+                resto = resto - trozos[primero].iov_len;
+                primero = primero + 1;
             }
+            if (primero < numTrozos) {
+                trozos[primero].iov_base = (char*) trozos[primero].iov_base + resto;
+                trozos[primero].iov_len -= resto;
+            }
+        }
+#endif
+        numTrozos = 0;
+        usado = 0;
+    }
+
+    // Vuelca lo pendiente y cierra. Devuelve false si algo ha fallado.
+    bool cerrar() {
+        volcar();
+#ifdef _WIN32
+        if (fichero != nullptr && !esSalidaEstandar) {
+            if (std::fclose(fichero) != 0) {
+                error = true;
+            }
+        }
+        fichero = nullptr;
+#else
+        if (fd >= 0 && !esSalidaEstandar) {
+            if (::close(fd) != 0) {
+                error = true;
+            }
+        }
+        fd = -1;
+#endif
+        return !error;
+    }
+
+    // Escribe un texto fijo (separadores, etiquetas...)
+    void escribirLiteral(const char* texto) {
+        copiarAlBuffer(texto, std::strlen(texto));
+    }
+
+    // Escribe un caracter
+    void escribirCaracter(char ch) {
+        copiarAlBuffer(&ch, 1);
+    }
+
+    // Escribe un campo tal cual: los largos sin copiarlos
+    void escribirCampo(const std::string& campo) {
+        if (campo.size() >= MINIMO_DIRECTO) {
+            agregarTrozo(campo.data(), campo.size());
+        } else {
+            copiarAlBuffer(campo.data(), campo.size());
         }
     }
+
+    // Escribe un entero en decimal
+    void escribirEntero(int valor) {
+        char cifras[12];
+        int n = 0;
+        unsigned int v = valor < 0 ? 0u - (unsigned int) valor : (unsigned int) valor;
+
+        do {
+            cifras[11 - n] = (char) ('0' + v % 10);
+            v = v / 10;
+            n = n + 1;
+        } while (v > 0);
+
+        if (valor < 0) {
+            cifras[11 - n] = '-';
+            n = n + 1;
+        }
+        copiarAlBuffer(cifras + 12 - n, (std::size_t) n);
+    }
+};
+
+// Formatos de exportacion a fichero
+enum FormatoExportacion {
+    FORMATO_CSV,
+    FORMATO_VCARD
 };
 
+// Escribe un campo CSV: entre comillas solo si lleva comas, comillas o
+// saltos de linea (RFC 4180)
+void escribirCampoCsv(EscritorVectorial& escritor, const std::string& campo) {
+    if (campo.find_first_of(",\"\r\n") == std::string::npos) {
+        escritor.escribirCampo(campo);
+        return;
+    }
+
+    escritor.escribirCaracter('"');
+    for (std::size_t i = 0; i < campo.size(); i++) {
+        if (campo[i] == '"') {
+            escritor.escribirCaracter('"');
+        }
+        escritor.escribirCaracter(campo[i]);
+    }
+    escritor.escribirCaracter('"');
+}
+
+// Escribe un valor de texto vCard escapando \ , ; y saltos de linea
+void escribirCampoVcard(EscritorVectorial& escritor, const std::string& campo) {
+    if (campo.find_first_of("\\,;\r\n") == std::string::npos) {
+        escritor.escribirCampo(campo);
+        return;
+    }
+
+    for (std::size_t i = 0; i < campo.size(); i++) {
+        char ch = campo[i];
+        if (ch == '\n') {
+            escritor.escribirLiteral("\\n");
+        } else if (ch != '\r') {
+            if (ch == '\\' || ch == ',' || ch == ';') {
+                escritor.escribirCaracter('\\');
+            }
+            escritor.escribirCaracter(ch);
+        }
+    }
+}
 
 // Exporta contactos de un perfil a otro
 void exportarContactos(Perfil* origen, Perfil* destino) {
@@ -535,8 +2090,520 @@ void exportarContactos(Perfil* origen, Perfil* destino) {
     }
 }
 
-// Carga inicial de perfiles
-void inicializarPerfiles(LinkedList<Perfil*>* listaPerfiles) {
+// Exporta los contactos de un perfil a un fichero CSV o vCard ("-" para la
+// salida estandar). Se escribe por bloques a medida que se recorre una
+// instantanea del perfil, asi que quien lee el fichero puede empezar a
+// procesarlo antes de que termine. Devuelve cuantos contactos se han
+// exportado o -1 si hay un error de escritura.
+int exportarContactosAFichero(Perfil* origen, const std::string& ruta, FormatoExportacion formato) {
+    if (origen == nullptr) {
+        return -1;
+    }
+
+    EscritorVectorial escritor;
+    if (!escritor.abrir(ruta)) {
+        return -1;
+    }
+
+    // La instantanea mantiene vivos los contactos hasta el ultimo volcado
+    ListaPersistente<Contacto> foto = origen->instantaneaContactos();
+    int exportados = 0;
+
+    if (formato == FORMATO_CSV) {
+        escritor.escribirLiteral("nombre,telefono,edad,ciudad,descripcion\r\n");
+    }
+
+    foto.recorrer([&](const Contacto* c) {
+        if (formato == FORMATO_CSV) {
+            escribirCampoCsv(escritor, c->getNombre());
+            escritor.escribirCaracter(',');
+            escribirCampoCsv(escritor, c->getTelefono());
+            escritor.escribirCaracter(',');
+            escritor.escribirEntero(c->getEdad());
+            escritor.escribirCaracter(',');
+            escribirCampoCsv(escritor, c->getCiudad());
+            escritor.escribirCaracter(',');
+            escribirCampoCsv(escritor, c->getDescripcion());
+            escritor.escribirLiteral("\r\n");
+        } else {
+            escritor.escribirLiteral("BEGIN:VCARD\r\nVERSION:3.0\r\nFN:");
+            escribirCampoVcard(escritor, c->getNombre());
+            escritor.escribirLiteral("\r\nN:");
+            escribirCampoVcard(escritor, c->getNombre());
+            escritor.escribirLiteral(";;;;\r\nTEL:");
+            escribirCampoVcard(escritor, c->getTelefono());
+            escritor.escribirLiteral("\r\nADR:;;;");
+            escribirCampoVcard(escritor, c->getCiudad());
+            escritor.escribirLiteral(";;;\r\nNOTE:");
+            escribirCampoVcard(escritor, c->getDescripcion());
+            escritor.escribirLiteral("\r\nX-EDAD:");
+            escritor.escribirEntero(c->getEdad());
+            escritor.escribirLiteral("\r\nEND:VCARD\r\n");
+        }
+        exportados = exportados + 1;
+    });
+
+    if (!escritor.cerrar()) {
+        return -1;
+    }
+    return exportados;
+}
+
+// Marca usada por las operaciones de conjunto: en cuantos perfiles
+// aparece un telefono y cual fue el ultimo perfil que lo conto
+struct MarcaTelefono {
+    int veces;
+    int ultimoPerfil;
+};
+
+// Cuenta, para cada telefono, en cuantos de los n perfiles aparece.
+// Cada perfil cuenta una sola vez aunque repita el telefono.
+void contarTelefonosPorPerfil(Perfil** perfiles, int n, TablaHash<MarcaTelefono>* tabla) {
+    for (int k = 0; k < n; k++) {
+        if (perfiles[k] != nullptr) {
+            int marca = k + 1;
+            perfiles[k]->recorrerContactos([&](const Contacto* c) {
+                if (c != nullptr) {
+                    MarcaTelefono* m = tabla->insertar(c->getTelefono());
+                    if (m->ultimoPerfil != marca) {
+                        m->ultimoPerfil = marca;
+                        m->veces = m->veces + 1;
+                    }
+                }
+            });
+        }
+    }
+}
+
+// Telefonos presentes en todos los perfiles indicados (interseccion).
+// Se devuelven en el orden de los contactos del primer perfil.
+// El llamador es responsable de borrar la lista devuelta.
+LinkedList<std::string>* telefonosEnComun(Perfil** perfiles, int n) {
+    LinkedList<std::string>* resultado = new LinkedList<std::string>();
+    if (n <= 0 || perfiles[0] == nullptr) {
+        return resultado;
+    }
+
+    TablaHash<MarcaTelefono> tabla(perfiles[0]->getNumeroContactos());
+    contarTelefonosPorPerfil(perfiles, n, &tabla);
+
+    perfiles[0]->recorrerContactos([&](const Contacto* c) {
+        if (c != nullptr) {
+            MarcaTelefono* m = tabla.buscar(c->getTelefono());
+            // Ponemos veces a 0 para no repetir telefonos duplicados
+            if (m != nullptr && m->veces == n) {
+                resultado->insertar_cola(c->getTelefono());
+                m->veces = 0;
+            }
+        }
+    });
+
+    return resultado;
+}
+
+// Telefonos del perfil origen que no aparecen en ninguno de los otros
+// (diferencia). El llamador es responsable de borrar la lista devuelta.
+LinkedList<std::string>* telefonosSoloEn(Perfil* origen, Perfil** otros, int n) {
+    LinkedList<std::string>* resultado = new LinkedList<std::string>();
+    if (origen == nullptr) {
+        return resultado;
+    }
+
+    TablaHash<MarcaTelefono> tabla(origen->getNumeroContactos());
+    contarTelefonosPorPerfil(otros, n, &tabla);
+
+    origen->recorrerContactos([&](const Contacto* c) {
+        if (c != nullptr) {
+            MarcaTelefono* m = tabla.insertar(c->getTelefono());
+            // veces == 0: no esta en los otros y aun no se ha anadido
+            if (m->veces == 0) {
+                resultado->insertar_cola(c->getTelefono());
+                m->veces = -1;
+            }
+        }
+    });
+
+    return resultado;
+}
+
+// Numero de telefonos distintos entre todos los perfiles (tamano de la union)
+int contarTelefonosUnion(Perfil** perfiles, int n) {
+    TablaHash<MarcaTelefono> tabla;
+    contarTelefonosPorPerfil(perfiles, n, &tabla);
+    return tabla.getSize();
+}
+
+// ---- Almacen de perfiles en fragmentos ----
+
+// Numero de ficheros (fragmentos) en que se reparten los perfiles
+const int NUM_FRAGMENTOS = 16;
+// Prefijo de los ficheros del almacen: agenda_00.txt, agenda_01.txt...
+const char* const PREFIJO_ALMACEN = "agenda";
+
+// Escribe un campo escapando barras, tabuladores y saltos de linea
+void escribirCampo(std::ostream& salida, const std::string& campo) {
+    for (std::size_t i = 0; i < campo.size(); i++) {
+        char ch = campo[i];
+        if (ch == '\\') {
+            salida << "\\\\";
+        } else if (ch == '\t') {
+            salida << "\\t";
+        } else if (ch == '\n') {
+            salida << "\\n";
+        } else if (ch != '\r') {
+            salida << ch;
+        }
+    }
+}
+
+// Separa una linea en campos por tabuladores deshaciendo los escapes.
+// Devuelve cuantos campos ha leido (como mucho maxCampos).
+int leerCampos(const std::string& linea, std::string* campos, int maxCampos) {
+    int n = 0;
+    campos[0].clear();
+
+    for (std::size_t i = 0; i < linea.size(); i++) {
+        char ch = linea[i];
+        if (ch == '\t') {
+            n = n + 1;
+            if (n == maxCampos) {
+                return n;
+            }
+            campos[n].clear();
+        } else if (ch == '\\' && i + 1 < linea.size()) {
+            i = i + 1;
+            if (linea[i] == 't') {
+                campos[n] += '\t';
+            } else if (linea[i] == 'n') {
+                campos[n] += '\n';
+            } else {
+                campos[n] += linea[i];
+            }
+        } else if (ch != '\r') {
+            campos[n] += ch;
+        }
+    }
+
+    return n + 1;
+}
+
+// Almacen de perfiles repartido en fragmentos independientes.
+// Cada perfil va al fragmento hashTexto(nombreUsuario) % numFragmentos y
+// cada fragmento es un fichero de texto:
+//   P<TAB>nombreUsuario<TAB>descripcion
+//   C<TAB>nombre<TAB>telefono<TAB>edad<TAB>ciudad<TAB>descripcion
+// (las lineas C pertenecen al ultimo perfil P leido).
+// Al arrancar, un grupo de hilos carga e indexa los fragmentos en paralelo.
+// Buscar un perfil solo espera a que este listo su fragmento, asi que el
+// menu se puede usar antes de que termine la carga completa.
+class AlmacenPerfiles {
+private:
+    std::string prefijo;
+    int numFragmentos;
+
+    // Perfiles de cada fragmento (el fragmento es su dueno)
+    LinkedList<Perfil*, ListaPropietaria>** fragmentos;
+    // Indice nombreUsuario -> perfil de cada fragmento
+    TablaHash<Perfil*>** indices;
+    // listos[f] indica si el fragmento f ya esta cargado
+    bool* listos;
+
+    std::mutex cerrojo;
+    std::condition_variable avisoListo;
+
+    // Grupo de hilos de carga: cada hilo coge el siguiente fragmento libre
+    std::thread* hilos;
+    int numHilos;
+    std::atomic<int> siguienteFragmento;
+
+    // Indice global telefono -> perfiles de todo el almacen
+    IndiceTelefonos* indiceTelefonos;
+
+    // Vista (no propietaria) de todos los perfiles ordenados por nombre,
+    // con indice posicional para elegirlos por numero en O(log n)
+    LinkedList<Perfil*>* todos;
+
+    std::string rutaFragmento(int f) {
+        std::string numero = std::to_string(f);
+        if (numero.size() < 2) {
+            numero = "0" + numero;
+        }
+        return prefijo + "_" + numero + ".txt";
+    }
+
+    // Lee el fichero de un fragmento (si no existe, queda vacio)
+    void cargarFragmento(int f) {
+        std::ifstream entrada(rutaFragmento(f).c_str());
+        std::string linea;
+        std::string campos[6];
+        Perfil* actual = nullptr;
+
+        while (std::getline(entrada, linea)) {
+            int n = leerCampos(linea, campos, 6);
+            if (n == 3 && campos[0] == "P") {
+                actual = new Perfil(campos[1], campos[2]);
+                actual->setIndice(indiceTelefonos);
+                fragmentos[f]->insertar_cola(actual);
+                *indices[f]->insertar(campos[1]) = actual;
+            } else if (n == 6 && campos[0] == "C" && actual != nullptr) {
+                int edad = std::atoi(campos[3].c_str());
+                actual->agregarContactoFinal(new Contacto(campos[1], campos[2], edad, campos[4], campos[5]));
+            }
+        }
+    }
+
+    // Bucle de cada hilo del grupo de carga
+    void trabajador() {
+        while (true) {
+            int f = siguienteFragmento.fetch_add(1);
+            if (f >= numFragmentos) {
+                return;
+            }
+
+            cargarFragmento(f);
+
+            std::lock_guard<std::mutex> guarda(cerrojo);
+            listos[f] = true;
+            avisoListo.notify_all();
+        }
+    }
+
+    // Bloquea hasta que el fragmento f este cargado
+    void esperarFragmento(int f) {
+        std::unique_lock<std::mutex> guarda(cerrojo);
+        while (!listos[f]) {
+            avisoListo.wait(guarda);
+        }
+    }
+
+    // Bloquea hasta que esten cargados todos los fragmentos
+    void esperarTodos() {
+        for (int f = 0; f < numFragmentos; f++) {
+            esperarFragmento(f);
+        }
+    }
+
+    // Espera a que terminen los hilos de carga
+    void terminarHilos() {
+        for (int i = 0; i < numHilos; i++) {
+            hilos[i].join();
+        }
+        delete[] hilos;
+        hilos = nullptr;
+        numHilos = 0;
+    }
+
+public:
+    // Constructor: almacen vacio (no lee nada hasta cargarEnParalelo)
+    AlmacenPerfiles(std::string prefijoFicheros, int fragmentosTotales) {
+        prefijo = prefijoFicheros;
+        numFragmentos = fragmentosTotales;
+        fragmentos = new LinkedList<Perfil*, ListaPropietaria>*[numFragmentos];
+        indices = new TablaHash<Perfil*>*[numFragmentos];
+        listos = new bool[numFragmentos];
+        for (int f = 0; f < numFragmentos; f++) {
+            fragmentos[f] = new LinkedList<Perfil*, ListaPropietaria>();
+            indices[f] = new TablaHash<Perfil*>();
+            listos[f] = false;
+        }
+        hilos = nullptr;
+        numHilos = 0;
+        siguienteFragmento = 0;
+        indiceTelefonos = new IndiceTelefonos();
+        todos = nullptr;
+    }
+
+    // Destructor: espera a la carga y libera perfiles y contactos
+    ~AlmacenPerfiles() {
+        terminarHilos();
+        // El indice se borra entero al final: no hace falta que cada
+        // perfil quite uno a uno sus telefonos al borrarse
+        for (int f = 0; f < numFragmentos; f++) {
+            fragmentos[f]->recorrer([](Perfil* p) {
+                p->soltarIndice();
+            });
+        }
+        for (int f = 0; f < numFragmentos; f++) {
+            delete fragmentos[f];
+            delete indices[f];
+        }
+        delete[] fragmentos;
+        delete[] indices;
+        delete[] listos;
+        delete todos;
+        delete indiceTelefonos;
+    }
+
+    AlmacenPerfiles(const AlmacenPerfiles&) = delete;
+    AlmacenPerfiles& operator=(const AlmacenPerfiles&) = delete;
+
+    // Fragmento al que pertenece un nombre de usuario
+    int fragmentoDe(const std::string& nombreUsuario) {
+        return (int) (hashTexto(nombreUsuario) % (unsigned int) numFragmentos);
+    }
+
+    // Indica si hay algun fichero del almacen en disco
+    bool hayDatosGuardados() {
+        for (int f = 0; f < numFragmentos; f++) {
+            std::ifstream entrada(rutaFragmento(f).c_str());
+            if (entrada.good()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Lanza la carga de todos los fragmentos con un grupo de hilos y
+    // vuelve enseguida. hilosPedidos <= 0 usa uno por nucleo.
+    void cargarEnParalelo(int hilosPedidos) {
+        if (hilosPedidos <= 0) {
+            hilosPedidos = (int) std::thread::hardware_concurrency();
+        }
+        if (hilosPedidos <= 0) {
+            hilosPedidos = 1;
+        }
+        if (hilosPedidos > numFragmentos) {
+            hilosPedidos = numFragmentos;
+        }
+
+        numHilos = hilosPedidos;
+        hilos = new std::thread[numHilos];
+        for (int i = 0; i < numHilos; i++) {
+            hilos[i] = std::thread(&AlmacenPerfiles::trabajador, this);
+        }
+    }
+
+    // Marca todos los fragmentos como cargados sin leer ningun fichero
+    // (para crear un almacen nuevo que sustituira al guardado)
+    void empezarVacio() {
+        std::lock_guard<std::mutex> guarda(cerrojo);
+        for (int f = 0; f < numFragmentos; f++) {
+            listos[f] = true;
+        }
+        avisoListo.notify_all();
+    }
+
+    // Busca un perfil por nombre esperando solo a su fragmento.
+    // Devuelve nullptr si no existe.
+    Perfil* buscarPerfil(const std::string& nombreUsuario) {
+        int f = fragmentoDe(nombreUsuario);
+        esperarFragmento(f);
+
+        Perfil** encontrado = indices[f]->buscar(nombreUsuario);
+        if (encontrado == nullptr) {
+            return nullptr;
+        }
+        return *encontrado;
+    }
+
+    // Anade un perfil nuevo a su fragmento (el almacen pasa a ser su dueno).
+    // Devuelve false si ya existe un perfil con ese nombre.
+    bool agregarPerfil(Perfil* perfil) {
+        std::string nombre = perfil->getNombreUsuario();
+        int f = fragmentoDe(nombre);
+        esperarFragmento(f);
+
+        if (indices[f]->buscar(nombre) != nullptr) {
+            return false;
+        }
+
+        fragmentos[f]->insertar_cola(perfil);
+        *indices[f]->insertar(nombre) = perfil;
+        perfil->setIndice(indiceTelefonos);
+
+        // La vista de todos los perfiles hay que rehacerla
+        delete todos;
+        todos = nullptr;
+        return true;
+    }
+
+    // Devuelve los perfiles que tienen el telefono en su agenda (espera a
+    // la carga completa). El llamador es responsable de borrar la lista.
+    LinkedList<Perfil*>* buscarPerfilesConTelefono(const std::string& telefono) {
+        esperarTodos();
+
+        LinkedList<Perfil*>* resultado = new LinkedList<Perfil*>();
+        indiceTelefonos->recorrerPerfilesCon(telefono, [&](Perfil* p) {
+            resultado->insertar_cola(p);
+        });
+        return resultado;
+    }
+
+    // Devuelve todos los perfiles ordenados por nombre (espera a la carga
+    // completa). La lista pertenece al almacen: no se debe borrar.
+    LinkedList<Perfil*>* obtenerTodos() {
+        esperarTodos();
+
+        if (todos == nullptr) {
+            int total = 0;
+            for (int f = 0; f < numFragmentos; f++) {
+                total = total + fragmentos[f]->getSize();
+            }
+
+            Perfil** ordenados = new Perfil*[total];
+            int k = 0;
+            for (int f = 0; f < numFragmentos; f++) {
+                fragmentos[f]->recorrer([&](Perfil* p) {
+                    ordenados[k] = p;
+                    k = k + 1;
+                });
+            }
+            std::sort(ordenados, ordenados + total, [](Perfil* a, Perfil* b) {
+                return a->getNombreUsuario() < b->getNombreUsuario();
+            });
+
+            // Los menus eligen perfiles por numero: lista con indice posicional
+            todos = new LinkedList<Perfil*>(true);
+            for (int i = 0; i < total; i++) {
+                todos->insertar_cola(ordenados[i]);
+            }
+            delete[] ordenados;
+        }
+
+        return todos;
+    }
+
+    // Guarda cada fragmento en su fichero. Devuelve false si alguno falla.
+    bool guardar() {
+        esperarTodos();
+        bool correcto = true;
+
+        for (int f = 0; f < numFragmentos; f++) {
+            std::ofstream salida(rutaFragmento(f).c_str());
+            if (!salida) {
+                correcto = false;
+            } else {
+                fragmentos[f]->recorrer([&](Perfil* p) {
+                    salida << "P\t";
+                    escribirCampo(salida, p->getNombreUsuario());
+                    salida << '\t';
+                    escribirCampo(salida, p->getDescripcion());
+                    salida << '\n';
+
+                    p->recorrerContactos([&](const Contacto* c) {
+                        salida << "C\t";
+                        escribirCampo(salida, c->getNombre());
+                        salida << '\t';
+                        escribirCampo(salida, c->getTelefono());
+                        salida << '\t' << c->getEdad() << '\t';
+                        escribirCampo(salida, c->getCiudad());
+                        salida << '\t';
+                        escribirCampo(salida, c->getDescripcion());
+                        salida << '\n';
+                    });
+                });
+                if (!salida) {
+                    correcto = false;
+                }
+            }
+        }
+
+        return correcto;
+    }
+};
+
+// Carga inicial de perfiles (cuando todavia no hay nada guardado)
+void inicializarPerfiles(AlmacenPerfiles* almacen) {
     // Perfil 1
     Perfil* p1 = new Perfil("Ana", "Le gusta la música y viajar");
     p1->agregarContactoFinal(new Contacto("Carlos",  "111111111", 25, "Madrid",   "Amigo de la universidad"));
@@ -561,19 +2628,75 @@ void inicializarPerfiles(LinkedList<Perfil*>* listaPerfiles) {
     p3->agregarContactoFinal(new Contacto("Elena",    "505050505", 25, "Murcia",   "Conocida de un curso"));
     p3->agregarContactoFinal(new Contacto("Sergio",   "606060606", 28, "Oviedo",   "Amigo de la universidad"));
 
-    // Insertamos los perfiles en la lista
-    listaPerfiles->insertar_cola(p1);
-    listaPerfiles->insertar_cola(p2);
-    listaPerfiles->insertar_cola(p3);
+    // Insertamos los perfiles en el almacen
+    almacen->agregarPerfil(p1);
+    almacen->agregarPerfil(p2);
+    almacen->agregarPerfil(p3);
 }
 
 
+// ---- Trazas de sesiones ----
+// Una traza es un fichero de texto con una operacion de menu por linea y
+// los campos separados por tabuladores (con los escapes de escribirCampo):
+//   login   usuario
+//   list
+//   add     nombre telefono edad ciudad descripcion
+//   mod     posicion nombre telefono edad ciudad descripcion
+//   del     posicion
+//   import  usuario
+//   export  usuario
+//   dups
+//   fuzzy   umbral
+//   compare usuario...          (perfiles con los que se compara)
+//   search  telefono            (no necesita sesion)
+//   fexport csv|vcard           (al reproducir se escribe a un temporal)
+// Las posiciones empiezan en 0 y se toman modulo el numero de contactos.
+// Ver la informacion del perfil y cerrar sesion no se graban: no tocan
+// datos y el siguiente login ya cambia de perfil.
+
+// Tipos de operacion de una traza (mismo orden que NOMBRES_OPERACION)
+enum TipoOperacion {
+    OP_LOGIN, OP_LIST, OP_ADD, OP_MOD, OP_DEL, OP_IMPORT, OP_EXPORT,
+    OP_DUPS, OP_FUZZY, OP_COMPARE, OP_SEARCH, OP_FEXPORT
+};
+const int NUM_TIPOS_OPERACION = 12;
+const char* const NOMBRES_OPERACION[NUM_TIPOS_OPERACION] = {
+    "login", "list", "add", "mod", "del", "import", "export",
+    "dups", "fuzzy", "compare", "search", "fexport"
+};
+// Campos como mucho por linea (compare graba solo los primeros perfiles)
+const int MAX_CAMPOS_TRAZA = 32;
+// Fichero temporal donde se escriben las fexport al reproducir una traza
+const char* const FICHERO_EXPORTACION_TRAZA = "traza_exportacion.tmp";
+
+// Fichero donde se graba la sesion del menu (--grabar); nullptr si no se graba
+std::ofstream* trazaGrabada = nullptr;
+
+// Anade una operacion a la traza grabada, si se esta grabando
+void grabarOperacion(TipoOperacion tipo, const std::string* campos, int n) {
+    if (trazaGrabada == nullptr) {
+        return;
+    }
+    if (n > MAX_CAMPOS_TRAZA - 1) {
+        n = MAX_CAMPOS_TRAZA - 1;
+    }
+
+    *trazaGrabada << NOMBRES_OPERACION[tipo];
+    for (int i = 0; i < n; i++) {
+        *trazaGrabada << '\t';
+        escribirCampo(*trazaGrabada, campos[i]);
+    }
+    // Se vuelca en cada linea para no perder la traza si el programa se corta
+    *trazaGrabada << std::endl;
+}
+
 // Muestra el menú principal
 int mostrarMenuPrincipal() {
     std::cout << "\n===== MENU PRINCIPAL =====\n";
     std::cout << "1. Ver perfiles disponibles\n";
     std::cout << "2. Iniciar sesion en un perfil\n";
-    std::cout << "3. Salir\n";
+    std::cout << "3. Buscar perfiles que tienen un telefono\n";
+    std::cout << "4. Salir\n";
     std::cout << "Seleccione una opcion: ";
 
     int op;
@@ -593,23 +2716,39 @@ void mostrarPerfiles(LinkedList<Perfil*>* listaPerfiles) {
     }
 }
 
-// Permite seleccionar un perfil
-Perfil* seleccionarPerfil(LinkedList<Perfil*>* listaPerfiles) {
-    mostrarPerfiles(listaPerfiles);
+// Permite seleccionar un perfil por nombre. Solo espera a que se cargue
+// el fragmento de ese perfil. Devuelve nullptr si no existe.
+Perfil* seleccionarPerfil(AlmacenPerfiles* almacen) {
+    std::string nombre;
 
-    int total = listaPerfiles->getSize();
-    int op;
+    std::cout << "Nombre de usuario: ";
+    std::cin >> std::ws;
+    std::getline(std::cin, nombre);
 
-    while (true) {
-        std::cout << "Seleccione un perfil (1-" << total << "): ";
-        std::cin >> op;
+    return almacen->buscarPerfil(nombre);
+}
 
-        if (op >= 1 && op <= total) {
-            return listaPerfiles->obtener_en(op - 1);
-        }
+// Muestra que perfiles tienen un telefono en su agenda
+void buscarPerfilesPorTelefono(AlmacenPerfiles* almacen) {
+    std::string telefono;
+
+    std::cout << "Telefono: ";
+    std::cin >> std::ws;
+    std::getline(std::cin, telefono);
+
+    grabarOperacion(OP_SEARCH, &telefono, 1);
+    LinkedList<Perfil*>* perfiles = almacen->buscarPerfilesConTelefono(telefono);
 
-        std::cout << "Opcion invalida.\n" << std::endl;
+    if (perfiles->estaVacia()) {
+        std::cout << "Ningun perfil tiene ese telefono.\n";
+    } else {
+        std::cout << "Perfiles con el telefono " << telefono << ":\n";
+        perfiles->recorrer([](Perfil* p) {
+            std::cout << "- " << p->getNombreUsuario() << std::endl;
+        });
     }
+
+    delete perfiles;
 }
 
 // Muestra la información básica del perfil
@@ -628,15 +2767,16 @@ void mostrarContactosPerfil(Perfil* perfilActual) {
         std::cout << "Este perfil no tiene contactos aun.\n";
     } else {
         std::cout << "\n=== LISTA DE CONTACTOS ===\n";
-        for (int i = 0; i < total; i++) {
-            Contacto* c = perfilActual->getContactoEn(i);
-            std::cout << (i + 1) << ". "
+        int i = 0;
+        perfilActual->recorrerContactos([&](const Contacto* c) {
+            i = i + 1;
+            std::cout << i << ". "
                       << c->getNombre() << " | "
                       << c->getTelefono() << " | "
                       << c->getEdad() << " | "
                       << c->getCiudad() << " | "
                       << c->getDescripcion() << std::endl;
-        }
+        });
     }
 }
 
@@ -669,6 +2809,9 @@ void agregarContactoDesdeTeclado(Perfil* perfilActual) {
         Contacto* nuevo = new Contacto(nombre, telefono, edad, ciudad, descripcion);
         perfilActual->agregarContactoFinal(nuevo);
 
+        std::string campos[] = { nombre, telefono, std::to_string(edad), ciudad, descripcion };
+        grabarOperacion(OP_ADD, campos, 5);
+
         std::cout << "Contacto agregado correctamente.\n";
     }
 }
@@ -687,8 +2830,6 @@ void modificarContactoPerfil(Perfil* perfilActual) {
         std::cin >> op;
 
         if (op >= 1 && op <= total) {
-            Contacto* c = perfilActual->getContactoEn(op - 1);
-
             std::cin.ignore();
 
             std::string nombre, telefono, ciudad, descripcion;
@@ -710,11 +2851,13 @@ void modificarContactoPerfil(Perfil* perfilActual) {
             std::cout << "Nueva descripcion: ";
             std::getline(std::cin, descripcion);
 
-            c->setNombre(nombre);
-            c->setTelefono(telefono);
-            c->setEdad(edad);
-            c->setCiudad(ciudad);
-            c->setDescripcion(descripcion);
+            // Los contactos guardados no se modifican: se sustituye por uno nuevo
+            Contacto* c = new Contacto(nombre, telefono, edad, ciudad, descripcion);
+            perfilActual->modificarContactoEn(op - 1, c);
+
+            std::string campos[] = { std::to_string(op - 1), nombre, telefono,
+                                     std::to_string(edad), ciudad, descripcion };
+            grabarOperacion(OP_MOD, campos, 6);
 
             std::cout << "Contacto modificado correctamente.\n";
         } else {
@@ -738,6 +2881,9 @@ void eliminarContactoPerfil(Perfil* perfilActual) {
 
         if (op >= 1 && op <= total) {
             perfilActual->eliminarContactoEn(op - 1);
+
+            std::string posicion = std::to_string(op - 1);
+            grabarOperacion(OP_DEL, &posicion, 1);
             std::cout << "Contacto eliminado correctamente.\n";
         } else {
             std::cout << "Opcion invalida.\n";
@@ -762,6 +2908,8 @@ void importarDesdeOtroPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPer
             std::cout << "No puede importar contactos de su propio perfil.\n";
         } else {
             perfilActual->importarContactosDesde(origen);
+            std::string usuario = origen->getNombreUsuario();
+            grabarOperacion(OP_IMPORT, &usuario, 1);
         }
     } else {
         std::cout << "Opcion invalida.\n";
@@ -785,6 +2933,8 @@ void exportarAHaciaOtroPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPe
             std::cout << "No puede exportar contactos a su propio perfil.\n";
         } else {
             exportarContactos(perfilActual, destino);
+            std::string usuario = destino->getNombreUsuario();
+            grabarOperacion(OP_EXPORT, &usuario, 1);
             std::cout << "Contactos exportados correctamente.\n";
         }
     } else {
@@ -792,11 +2942,119 @@ void exportarAHaciaOtroPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPe
     }
 }
 
+// Compara los contactos del perfil con uno o varios perfiles
+void compararConOtrosPerfiles(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
+    mostrarPerfiles(listaPerfiles);
+
+    int total = listaPerfiles->getSize();
+    int n;
+
+    std::cout << "Con cuantos perfiles desea comparar (1-" << total << "): ";
+    std::cin >> n;
+
+    if (n < 1 || n > total) {
+        std::cout << "Opcion invalida.\n";
+        return;
+    }
+
+    // perfiles[0] es el perfil actual, el resto son los elegidos
+    Perfil** perfiles = new Perfil*[n + 1];
+    perfiles[0] = perfilActual;
+
+    for (int k = 1; k <= n; k++) {
+        int op;
+        std::cout << "Seleccione el perfil " << k << ": ";
+        std::cin >> op;
+
+        if (op < 1 || op > total) {
+            std::cout << "Opcion invalida.\n";
+            delete[] perfiles;
+            return;
+        }
+        perfiles[k] = listaPerfiles->obtener_en(op - 1);
+    }
+
+    if (trazaGrabada != nullptr) {
+        std::string* nombres = new std::string[n];
+        for (int k = 1; k <= n; k++) {
+            nombres[k - 1] = perfiles[k]->getNombreUsuario();
+        }
+        grabarOperacion(OP_COMPARE, nombres, n);
+        delete[] nombres;
+    }
+
+    LinkedList<std::string>* comunes = telefonosEnComun(perfiles, n + 1);
+    LinkedList<std::string>* exclusivos = telefonosSoloEn(perfilActual, perfiles + 1, n);
+    int totalUnion = contarTelefonosUnion(perfiles, n + 1);
+
+    std::cout << "\nTelefonos en comun (" << comunes->getSize() << "):\n";
+    comunes->recorrer([](std::string telefono) {
+        std::cout << "- " << telefono << std::endl;
+    });
+
+    std::cout << "Telefonos solo en \"" << perfilActual->getNombreUsuario()
+              << "\" (" << exclusivos->getSize() << "):\n";
+    exclusivos->recorrer([](std::string telefono) {
+        std::cout << "- " << telefono << std::endl;
+    });
+
+    std::cout << "Telefonos distintos entre todos los perfiles: " << totalUnion << std::endl;
+
+    delete comunes;
+    delete exclusivos;
+    delete[] perfiles;
+}
+
+// Pide el umbral de similitud y muestra los contactos parecidos
+void mostrarContactosParecidos(Perfil* perfilActual) {
+    double umbral;
+    std::cout << "Similitud minima entre 0 y 1 (por ejemplo 0.8): ";
+    std::cin >> umbral;
+
+    if (umbral < 0 || umbral > 1) {
+        std::cout << "Opcion invalida.\n";
+    } else {
+        std::string texto = std::to_string(umbral);
+        grabarOperacion(OP_FUZZY, &texto, 1);
+        perfilActual->detectarContactosParecidos(umbral);
+    }
+}
+
+// Exporta los contactos del perfil a un fichero CSV o vCard
+void exportarAFichero(Perfil* perfilActual) {
+    int op;
+    std::cout << "Formato (1. CSV, 2. vCard): ";
+    std::cin >> op;
+
+    if (op != 1 && op != 2) {
+        std::cout << "Opcion invalida.\n";
+        return;
+    }
+
+    std::string ruta;
+    std::cout << "Fichero de destino: ";
+    std::cin >> std::ws;
+    std::getline(std::cin, ruta);
+
+    FormatoExportacion formato = op == 1 ? FORMATO_CSV : FORMATO_VCARD;
+    int exportados = exportarContactosAFichero(perfilActual, ruta, formato);
+
+    std::string nombreFormato = op == 1 ? "csv" : "vcard";
+    grabarOperacion(OP_FEXPORT, &nombreFormato, 1);
+
+    if (exportados < 0) {
+        std::cout << "No se ha podido escribir el fichero \"" << ruta << "\".\n";
+    } else {
+        std::cout << "Se han exportado " << exportados
+                  << " contactos a \"" << ruta << "\".\n";
+    }
+}
+
 // Menú de gestión del perfil
-void menuPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
+void menuPerfil(Perfil* perfilActual, AlmacenPerfiles* almacen) {
     int op = 0;
 
-    while (op != 9) {
+    while (op != 12) {
         std::cout << "\n===== MENU DEL PERFIL =====\n";
         std::cout << "1. Ver informacion del perfil\n";
         std::cout << "2. Ver lista de contactos\n";
@@ -806,7 +3064,10 @@ void menuPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
         std::cout << "6. Importar contactos desde otro perfil\n";
         std::cout << "7. Exportar contactos a otro perfil\n";
         std::cout << "8. Mostrar contactos duplicados\n";
-        std::cout << "9. Cerrar sesion\n";
+        std::cout << "9. Comparar contactos con otros perfiles\n";
+        std::cout << "10. Mostrar contactos parecidos\n";
+        std::cout << "11. Exportar contactos a un fichero (CSV/vCard)\n";
+        std::cout << "12. Cerrar sesion\n";
         std::cout << "Seleccione una opcion: ";
 
         std::cin >> op;
@@ -814,6 +3075,7 @@ void menuPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
         if (op == 1) {
             mostrarInfoPerfil(perfilActual);
         } else if (op == 2) {
+            grabarOperacion(OP_LIST, nullptr, 0);
             mostrarContactosPerfil(perfilActual);
         } else if (op == 3) {
             agregarContactoDesdeTeclado(perfilActual);
@@ -822,12 +3084,19 @@ void menuPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
         } else if (op == 5) {
             eliminarContactoPerfil(perfilActual);
         } else if (op == 6) {
-            importarDesdeOtroPerfil(perfilActual, listaPerfiles);
+            importarDesdeOtroPerfil(perfilActual, almacen->obtenerTodos());
         } else if (op == 7) {
-            exportarAHaciaOtroPerfil(perfilActual, listaPerfiles);
+            exportarAHaciaOtroPerfil(perfilActual, almacen->obtenerTodos());
         } else if (op == 8) {
+            grabarOperacion(OP_DUPS, nullptr, 0);
             perfilActual->detectarContactosDuplicados();
         } else if (op == 9) {
+            compararConOtrosPerfiles(perfilActual, almacen->obtenerTodos());
+        } else if (op == 10) {
+            mostrarContactosParecidos(perfilActual);
+        } else if (op == 11) {
+            exportarAFichero(perfilActual);
+        } else if (op == 12) {
             std::cout << "Cerrando sesion...\n";
         } else {
             std::cout << "Opcion invalida.\n";
@@ -835,34 +3104,639 @@ void menuPerfil(Perfil* perfilActual, LinkedList<Perfil*>* listaPerfiles) {
     }
 }
 
-// main con menú principal
-int main() {
-    LinkedList<Perfil*>* perfiles = new LinkedList<Perfil*>();
-    inicializarPerfiles(perfiles);
+// ---- Generador de datos de prueba ----
+
+// Generador pseudoaleatorio splitmix64. Se usa en lugar de <random> para
+// que la misma semilla produzca los mismos datos en cualquier plataforma.
+class GeneradorAleatorio {
+private:
+    unsigned long long estado;
+
+public:
+    GeneradorAleatorio(unsigned long long semilla) {
+        estado = semilla;
+    }
+
+    unsigned long long siguiente() {
+        estado = estado + 0x9E3779B97F4A7C15ULL;
+        unsigned long long z = estado;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Entero en [0, n)
+    int entero(int n) {
+        return (int) (siguiente() % (unsigned long long) n);
+    }
+
+    // Real en [0, 1)
+    double real() {
+        return (double) (siguiente() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Indice en [0, n) con probabilidad proporcional a pesos[i]
+    int ponderado(const int* pesos, int n) {
+        int total = 0;
+        for (int i = 0; i < n; i++) {
+            total = total + pesos[i];
+        }
+        int r = entero(total);
+        int i = 0;
+        while (r >= pesos[i]) {
+            r = r - pesos[i];
+            i = i + 1;
+        }
+        return i;
+    }
+};
+
+// Parametros del generador de perfiles
+struct ConfigGenerador {
+    int perfiles;                // numero de perfiles
+    int contactos;               // contactos por perfil
+    unsigned long long semilla;  // misma semilla -> mismos datos
+    double tasaDuplicados;       // prob. de repetir un telefono del mismo perfil
+    double tasaCompartidos;      // prob. de usar un telefono comun a varios perfiles
+    double tasaFormatoLargo;     // prob. de escribir el telefono como "+34 6xx xx xx xx"
+};
+
+// Nombre de usuario del perfil k generado
+std::string nombreUsuarioGenerado(int k) {
+    return "usuario" + std::to_string(k);
+}
+
+// Telefono movil aleatorio de 9 cifras
+std::string telefonoAleatorio(GeneradorAleatorio& azar) {
+    std::string t = "6";
+    for (int i = 0; i < 8; i++) {
+        t += (char) ('0' + azar.entero(10));
+    }
+    return t;
+}
+
+// Mismo telefono con prefijo y espacios: "+34 6xx xx xx xx"
+std::string telefonoFormatoLargo(const std::string& t) {
+    if (t.size() != 9) {
+        return t;
+    }
+    return "+34 " + t.substr(0, 3) + " " + t.substr(3, 2) + " "
+           + t.substr(5, 2) + " " + t.substr(7, 2);
+}
+
+// Llena el almacen con perfiles sinteticos de tamano y reparto realistas:
+// ciudades y nombres con frecuencias desiguales (muchas colisiones de
+// nombre, variantes con y sin tilde), edades concentradas entre 20 y 50,
+// telefonos repetidos dentro del perfil y telefonos comunes entre perfiles.
+void generarPerfiles(AlmacenPerfiles* almacen, ConfigGenerador config) {
+    static const char* ciudades[] = {
+        "Madrid", "Barcelona", "Valencia", "Sevilla", "Zaragoza", "Malaga",
+        "Murcia", "Palma", "Bilbao", "Alicante", "Cordoba", "Valladolid",
+        "Vigo", "Gijon", "Granada", "A Coruna", "Oviedo", "Salamanca"
+    };
+    static const int pesosCiudades[] = {
+        33, 25, 8, 7, 7, 6, 5, 4, 3, 3, 3, 3, 3, 3, 2, 2, 2, 1
+    };
+    // Pares sin tilde / con tilde (igual si no lleva)
+    static const char* nombres[][2] = {
+        {"Maria", "María"}, {"Jose", "José"}, {"Lucia", "Lucía"}, {"Antonio", "Antonio"},
+        {"Carmen", "Carmen"}, {"Manuel", "Manuel"}, {"Ana", "Ana"}, {"David", "David"},
+        {"Laura", "Laura"}, {"Javier", "Javier"}, {"Sofia", "Sofía"}, {"Raul", "Raúl"},
+        {"Marta", "Marta"}, {"Sergio", "Sergio"}, {"Elena", "Elena"}, {"Ruben", "Rubén"},
+        {"Paula", "Paula"}, {"Ivan", "Iván"}, {"Irene", "Irene"}, {"Angel", "Ángel"},
+        {"Ines", "Inés"}, {"Hugo", "Hugo"}, {"Julia", "Julia"}, {"Adrian", "Adrián"}
+    };
+    static const char* apellidos[] = {
+        "Garcia", "Rodriguez", "Gonzalez", "Fernandez", "Lopez", "Martinez",
+        "Sanchez", "Perez", "Gomez", "Martin", "Jimenez", "Ruiz", "Hernandez",
+        "Diaz", "Moreno", "Munoz", "Alvarez", "Romero", "Alonso", "Gutierrez"
+    };
+    static const char* descripciones[] = {
+        "Amigo de la universidad", "Companera de trabajo", "Conocido del gimnasio",
+        "Familia", "Vecino", "Contacto de un viaje", "Amiga de la infancia", ""
+    };
+    const int numCiudades = 18;
+    const int numNombres = 24;
+    const int numApellidos = 20;
+
+    // Frecuencia de nombres y apellidos tipo Zipf: el primero es el mas comun
+    int pesosNombres[numNombres];
+    for (int i = 0; i < numNombres; i++) {
+        pesosNombres[i] = 1200 / (i + 1);
+    }
+    int pesosApellidos[numApellidos];
+    for (int i = 0; i < numApellidos; i++) {
+        pesosApellidos[i] = 1200 / (i + 1);
+    }
+
+    GeneradorAleatorio azar(config.semilla);
+
+    // Telefonos que aparecen en varios perfiles (contactos en comun)
+    int numCompartidos = config.perfiles * config.contactos / 100;
+    if (numCompartidos < 16) {
+        numCompartidos = 16;
+    }
+    std::string* compartidos = new std::string[numCompartidos];
+    for (int i = 0; i < numCompartidos; i++) {
+        compartidos[i] = telefonoAleatorio(azar);
+    }
+
+    // Telefonos del perfil en curso, para poder repetirlos
+    std::string* delPerfil = new std::string[config.contactos > 0 ? config.contactos : 1];
+
+    for (int k = 0; k < config.perfiles; k++) {
+        Perfil* p = new Perfil(nombreUsuarioGenerado(k), descripciones[azar.entero(7)]);
+
+        for (int i = 0; i < config.contactos; i++) {
+            const char** nombre = nombres[azar.ponderado(pesosNombres, numNombres)];
+            std::string completo = nombre[azar.real() < 0.3 ? 1 : 0];
+            completo += " ";
+            completo += apellidos[azar.ponderado(pesosApellidos, numApellidos)];
+
+            std::string telefono;
+            double r = azar.real();
+            if (i > 0 && r < config.tasaDuplicados) {
+                telefono = delPerfil[azar.entero(i)];
+            } else if (r < config.tasaDuplicados + config.tasaCompartidos) {
+                telefono = compartidos[azar.entero(numCompartidos)];
+            } else {
+                telefono = telefonoAleatorio(azar);
+            }
+            delPerfil[i] = telefono;
+            if (azar.real() < config.tasaFormatoLargo) {
+                telefono = telefonoFormatoLargo(telefono);
+            }
+
+            // Edad: suma de tres uniformes (campana entre 18 y 57),
+            // con un 5% de edades mayores
+            int edad = 18 + azar.entero(14) + azar.entero(14) + azar.entero(14);
+            if (azar.real() < 0.05) {
+                edad = 58 + azar.entero(33);
+            }
+
+            p->agregarContactoFinal(new Contacto(completo, telefono, edad,
+                                                 ciudades[azar.ponderado(pesosCiudades, numCiudades)],
+                                                 descripciones[azar.entero(8)]));
+        }
+
+        almacen->agregarPerfil(p);
+    }
+
+    delete[] compartidos;
+    delete[] delPerfil;
+}
+
+// Escribe una traza sintetica con una mezcla de operaciones parecida a
+// la de uso real (sobre todo altas y cambios, pocas detecciones)
+bool generarTraza(const std::string& ruta, int numOperaciones, int numPerfiles, unsigned long long semilla) {
+    static const int pesos[NUM_TIPOS_OPERACION] = { 10, 10, 35, 20, 15, 3, 3, 2, 2, 2, 5, 1 };
+    std::ofstream salida(ruta.c_str());
+    if (!salida || numPerfiles <= 0) {
+        return false;
+    }
+
+    GeneradorAleatorio azar(semilla);
+
+    for (int i = 0; i < numOperaciones; i++) {
+        // La primera operacion siempre inicia sesion
+        int tipo = i == 0 ? OP_LOGIN : azar.ponderado(pesos, NUM_TIPOS_OPERACION);
+        salida << NOMBRES_OPERACION[tipo];
+
+        if (tipo == OP_LOGIN || tipo == OP_IMPORT || tipo == OP_EXPORT) {
+            salida << '\t' << nombreUsuarioGenerado(azar.entero(numPerfiles));
+        } else if (tipo == OP_ADD || tipo == OP_MOD) {
+            if (tipo == OP_MOD) {
+                salida << '\t' << azar.entero(1 << 30);
+            }
+            salida << "\tNuevo " << i << '\t' << telefonoAleatorio(azar)
+                   << '\t' << (18 + azar.entero(60)) << "\tMadrid\tAnadido en la traza";
+        } else if (tipo == OP_DEL) {
+            salida << '\t' << azar.entero(1 << 30);
+        } else if (tipo == OP_FUZZY) {
+            salida << "\t0.85";
+        } else if (tipo == OP_COMPARE) {
+            int numComparados = 1 + azar.entero(3);
+            for (int k = 0; k < numComparados; k++) {
+                salida << '\t' << nombreUsuarioGenerado(azar.entero(numPerfiles));
+            }
+        } else if (tipo == OP_SEARCH) {
+            salida << '\t' << telefonoAleatorio(azar);
+        } else if (tipo == OP_FEXPORT) {
+            salida << (azar.entero(2) == 0 ? "\tcsv" : "\tvcard");
+        }
+        salida << '\n';
+    }
+
+    return (bool) salida;
+}
+
+// Muestras de latencia (en nanosegundos) de un tipo de operacion
+class RegistroLatencias {
+private:
+    long long* muestras;
+    int size;
+    int capacidad;
+
+public:
+    RegistroLatencias() {
+        capacidad = 256;
+        muestras = new long long[capacidad];
+        size = 0;
+    }
+
+    ~RegistroLatencias() {
+        delete[] muestras;
+    }
+
+    RegistroLatencias(const RegistroLatencias&) = delete;
+    RegistroLatencias& operator=(const RegistroLatencias&) = delete;
+
+    int getSize() {
+        return size;
+    }
+
+    void agregar(long long nanosegundos) {
+        if (size == capacidad) {
+            long long* nuevas = new long long[capacidad * 2];
+            for (int i = 0; i < size; i++) {
+                nuevas[i] = muestras[i];
+            }
+            delete[] muestras;
+            muestras = nuevas;
+            capacidad = capacidad * 2;
+        }
+        muestras[size] = nanosegundos;
+        size = size + 1;
+    }
+
+    // Ordena las muestras (necesario antes de pedir percentiles)
+    void ordenar() {
+        std::sort(muestras, muestras + size);
+    }
+
+    // Percentil p (0-100) por rango mas cercano; las muestras deben estar ordenadas
+    long long percentil(double p) {
+        if (size == 0) {
+            return 0;
+        }
+        int i = (int) (p / 100.0 * size + 0.999999) - 1;
+        if (i < 0) {
+            i = 0;
+        }
+        if (i >= size) {
+            i = size - 1;
+        }
+        return muestras[i];
+    }
+};
+
+// Ejecuta una linea de traza sobre el almacen. Devuelve el tipo de
+// operacion o -1 si la linea no es valida o no hay sesion iniciada.
+int ejecutarOperacionTraza(AlmacenPerfiles* almacen, Perfil*& actual, std::string* campos, int n) {
+    int tipo = -1;
+    for (int t = 0; t < NUM_TIPOS_OPERACION; t++) {
+        if (campos[0] == NOMBRES_OPERACION[t]) {
+            tipo = t;
+        }
+    }
+
+    if (tipo == OP_LOGIN && n >= 2) {
+        actual = almacen->buscarPerfil(campos[1]);
+        return tipo;
+    }
+    if (tipo == OP_SEARCH && n >= 2) {
+        delete almacen->buscarPerfilesConTelefono(campos[1]);
+        return tipo;
+    }
+    if (tipo < 0 || actual == nullptr) {
+        return -1;
+    }
+
+    int total = actual->getNumeroContactos();
+
+    if (tipo == OP_LIST) {
+        mostrarContactosPerfil(actual);
+    } else if (tipo == OP_ADD && n >= 6) {
+        if (!actual->existeTelefono(campos[2])) {
+            actual->agregarContactoFinal(new Contacto(campos[1], campos[2], std::atoi(campos[3].c_str()),
+                                                      campos[4], campos[5]));
+        }
+    } else if (tipo == OP_MOD && n >= 7) {
+        if (total > 0) {
+            int pos = std::atoi(campos[1].c_str()) % total;
+            actual->modificarContactoEn(pos, new Contacto(campos[2], campos[3], std::atoi(campos[4].c_str()),
+                                                          campos[5], campos[6]));
+        }
+    } else if (tipo == OP_DEL && n >= 2) {
+        if (total > 0) {
+            actual->eliminarContactoEn(std::atoi(campos[1].c_str()) % total);
+        }
+    } else if (tipo == OP_IMPORT && n >= 2) {
+        Perfil* origen = almacen->buscarPerfil(campos[1]);
+        if (origen != nullptr && origen != actual) {
+            actual->importarContactosDesde(origen);
+        }
+    } else if (tipo == OP_EXPORT && n >= 2) {
+        Perfil* destino = almacen->buscarPerfil(campos[1]);
+        if (destino != nullptr && destino != actual) {
+            exportarContactos(actual, destino);
+        }
+    } else if (tipo == OP_DUPS) {
+        actual->detectarContactosDuplicados();
+    } else if (tipo == OP_FUZZY && n >= 2) {
+        actual->detectarContactosParecidos(std::atof(campos[1].c_str()));
+    } else if (tipo == OP_COMPARE && n >= 2) {
+        // Como en el menu: perfiles[0] es el actual, el resto los comparados
+        Perfil** perfiles = new Perfil*[n];
+        int numPerfiles = 1;
+        perfiles[0] = actual;
+        for (int k = 1; k < n; k++) {
+            Perfil* p = almacen->buscarPerfil(campos[k]);
+            if (p != nullptr) {
+                perfiles[numPerfiles] = p;
+                numPerfiles = numPerfiles + 1;
+            }
+        }
+        delete telefonosEnComun(perfiles, numPerfiles);
+        delete telefonosSoloEn(actual, perfiles + 1, numPerfiles - 1);
+        contarTelefonosUnion(perfiles, numPerfiles);
+        delete[] perfiles;
+    } else if (tipo == OP_FEXPORT && n >= 2) {
+        // La ruta original no se usa: se escribe a un temporal y se borra
+        FormatoExportacion formato = campos[1] == "vcard" ? FORMATO_VCARD : FORMATO_CSV;
+        exportarContactosAFichero(actual, FICHERO_EXPORTACION_TRAZA, formato);
+        std::remove(FICHERO_EXPORTACION_TRAZA);
+    } else {
+        return -1;
+    }
+
+    return tipo;
+}
+
+// Reproduce una traza contra el almacen y muestra el rendimiento:
+// operaciones por segundo y latencias p50/p95/p99/max por tipo.
+// La salida de las propias operaciones se descarta.
+bool reproducirTraza(AlmacenPerfiles* almacen, const std::string& ruta) {
+    std::ifstream entrada(ruta.c_str());
+    if (!entrada) {
+        return false;
+    }
+
+    RegistroLatencias* registros = new RegistroLatencias[NUM_TIPOS_OPERACION];
+    Perfil* actual = nullptr;
+    int invalidas = 0;
+    std::string linea;
+    std::string campos[MAX_CAMPOS_TRAZA];
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+    while (std::getline(entrada, linea)) {
+        int n = leerCampos(linea, campos, MAX_CAMPOS_TRAZA);
+
+        std::streambuf* consola = std::cout.rdbuf(nullptr);
+        std::chrono::steady_clock::time_point antes = std::chrono::steady_clock::now();
+        int tipo = ejecutarOperacionTraza(almacen, actual, campos, n);
+        std::chrono::steady_clock::time_point despues = std::chrono::steady_clock::now();
+        std::cout.rdbuf(consola);
+        std::cout.clear();
+
+        if (tipo < 0) {
+            invalidas = invalidas + 1;
+        } else {
+            registros[tipo].agregar(std::chrono::duration_cast<std::chrono::nanoseconds>(despues - antes).count());
+        }
+    }
+
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    int total = 0;
+    for (int t = 0; t < NUM_TIPOS_OPERACION; t++) {
+        total = total + registros[t].getSize();
+    }
+
+    std::cout << "\n=== RESULTADO DE LA TRAZA ===\n";
+    std::cout << "Operaciones: " << total << " en " << segundos << " s ("
+              << (segundos > 0 ? total / segundos : 0.0) << " op/s)\n";
+    if (invalidas > 0) {
+        std::cout << "Lineas ignoradas (no validas o sin sesion): " << invalidas << "\n";
+    }
+    std::cout << std::left << std::setw(8) << "op" << std::right
+              << std::setw(10) << "cuenta" << std::setw(12) << "p50 (us)"
+              << std::setw(12) << "p95 (us)" << std::setw(12) << "p99 (us)"
+              << std::setw(12) << "max (us)" << "\n";
+
+    for (int t = 0; t < NUM_TIPOS_OPERACION; t++) {
+        RegistroLatencias& r = registros[t];
+        if (r.getSize() > 0) {
+            r.ordenar();
+            std::cout << std::left << std::setw(8) << NOMBRES_OPERACION[t] << std::right
+                      << std::setw(10) << r.getSize()
+                      << std::setw(12) << r.percentil(50) / 1000
+                      << std::setw(12) << r.percentil(95) / 1000
+                      << std::setw(12) << r.percentil(99) / 1000
+                      << std::setw(12) << r.percentil(100) / 1000 << "\n";
+        }
+    }
+
+    delete[] registros;
+    return true;
+}
+
+// Campo CSV esperado, construido a mano para comparar con el escritor
+std::string textoCampoCsv(const std::string& campo) {
+    if (campo.find_first_of(",\"\r\n") == std::string::npos) {
+        return campo;
+    }
+    std::string r = "\"";
+    for (std::size_t i = 0; i < campo.size(); i++) {
+        if (campo[i] == '"') {
+            r += '"';
+        }
+        r += campo[i];
+    }
+    return r + "\"";
+}
+
+// Exporta a CSV muchos contactos con campos largos (mas de MAX_TROZOS
+// trozos por volcado) y comprueba que el fichero sale byte a byte igual
+// que el texto esperado. Devuelve true si coinciden.
+bool comprobarExportacion(const std::string& ruta) {
+    const int numContactos = 5000;
+    Perfil perfil("comprobacion", "");
+    std::string esperado = "nombre,telefono,edad,ciudad,descripcion\r\n";
+
+    for (int i = 0; i < numContactos; i++) {
+        std::string numero = std::to_string(i);
+        std::string nombre = "Contacto de prueba con un nombre bastante largo numero " + numero;
+        std::string telefono = std::to_string(600000000 + i);
+        std::string ciudad = i % 3 == 0 ? "Ciudad, con coma" : "Ciudad";
+        std::string descripcion = "Descripcion larga que se escribe directamente desde el contacto, \"" + numero + "\"";
+        if (i % 2 == 0) {
+            descripcion = "Descripcion larga sin caracteres especiales para el contacto " + numero;
+        }
+
+        perfil.agregarContactoFinal(new Contacto(nombre, telefono, i % 100, ciudad, descripcion));
+        esperado += textoCampoCsv(nombre) + "," + textoCampoCsv(telefono) + ","
+                    + std::to_string(i % 100) + "," + textoCampoCsv(ciudad) + ","
+                    + textoCampoCsv(descripcion) + "\r\n";
+    }
+
+    if (exportarContactosAFichero(&perfil, ruta, FORMATO_CSV) != numContactos) {
+        std::cout << "No se ha podido exportar a " << ruta << "\n";
+        return false;
+    }
+
+    std::ifstream entrada(ruta.c_str(), std::ios::binary);
+    std::string leido((std::istreambuf_iterator<char>(entrada)), std::istreambuf_iterator<char>());
+    if (leido != esperado) {
+        std::size_t i = 0;
+        while (i < leido.size() && i < esperado.size() && leido[i] == esperado[i]) {
+            i++;
+        }
+        std::cout << "La exportacion no coincide a partir del byte " << i << "\n";
+        return false;
+    }
+
+    std::cout << "Exportacion correcta (" << numContactos << " contactos).\n";
+    return true;
+}
+
+// Muestra las opciones de linea de comandos para pruebas de carga
+void mostrarUsoPruebas(const char* programa) {
+    std::cout << "Uso:\n"
+              << "  " << programa << "                       (menu interactivo)\n"
+              << "  " << programa << " --grabar FICHERO      (menu interactivo grabando la sesion)\n"
+              << "  " << programa << " --generar PREFIJO P M SEMILLA  (guarda P perfiles de M contactos\n"
+              << "      en PREFIJO_NN.txt; no sobrescribe ficheros que ya existan)\n"
+              << "  " << programa << " --generar-traza FICHERO N P SEMILLA\n"
+              << "  " << programa << " --reproducir PREFIJO FICHERO\n"
+              << "  " << programa << " --comprobar-exportacion FICHERO\n";
+}
+
+// Modos de linea de comandos para pruebas de carga. Devuelve el codigo
+// de salida del programa.
+int ejecutarModoPruebas(int argc, char** argv) {
+    std::string modo = argv[1];
+
+    // Los modos que escriben o leen perfiles piden el prefijo de los ficheros
+    // para no tocar la agenda real del menu (PREFIJO_ALMACEN) por descuido
+    if (modo == "--generar" && argc == 6) {
+        ConfigGenerador config;
+        config.perfiles = std::atoi(argv[3]);
+        config.contactos = std::atoi(argv[4]);
+        config.semilla = std::strtoull(argv[5], nullptr, 10);
+        config.tasaDuplicados = 0.02;
+        config.tasaCompartidos = 0.05;
+        config.tasaFormatoLargo = 0.03;
+
+        AlmacenPerfiles almacen(argv[2], NUM_FRAGMENTOS);
+        if (almacen.hayDatosGuardados()) {
+            std::cout << "Ya hay perfiles guardados con el prefijo " << argv[2]
+                      << "; borralos o usa otro prefijo.\n";
+            return 1;
+        }
+        almacen.empezarVacio();
+        generarPerfiles(&almacen, config);
+        if (!almacen.guardar()) {
+            std::cout << "No se han podido guardar todos los perfiles.\n";
+            return 1;
+        }
+        std::cout << "Generados " << config.perfiles << " perfiles de "
+                  << config.contactos << " contactos.\n";
+        return 0;
+    }
+
+    if (modo == "--generar-traza" && argc == 6) {
+        if (!generarTraza(argv[2], std::atoi(argv[3]), std::atoi(argv[4]), std::strtoull(argv[5], nullptr, 10))) {
+            std::cout << "No se ha podido escribir la traza.\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (modo == "--reproducir" && argc == 4) {
+        AlmacenPerfiles almacen(argv[2], NUM_FRAGMENTOS);
+        if (!almacen.hayDatosGuardados()) {
+            std::cout << "No hay perfiles guardados con el prefijo " << argv[2] << ".\n";
+            return 1;
+        }
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        almacen.cargarEnParalelo(0);
+        int perfiles = almacen.obtenerTodos()->getSize();
+        double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+        std::cout << "Cargados " << perfiles << " perfiles en " << segundos << " s\n";
+
+        if (!reproducirTraza(&almacen, argv[3])) {
+            std::cout << "No se ha podido leer la traza.\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (modo == "--comprobar-exportacion" && argc == 3) {
+        return comprobarExportacion(argv[2]) ? 0 : 1;
+    }
+
+    mostrarUsoPruebas(argv[0]);
+    return 1;
+}
+
+
+// main con menú principal (o modos de prueba si hay argumentos).
+// Con --grabar FICHERO se usa el menu normal y cada operacion se anade
+// a FICHERO en el formato de las trazas, para reproducirla despues.
+int main(int argc, char** argv) {
+    if (argc == 3 && std::string(argv[1]) == "--grabar") {
+        trazaGrabada = new std::ofstream(argv[2], std::ios::app);
+        if (!*trazaGrabada) {
+            std::cout << "No se puede abrir la traza " << argv[2] << "\n";
+            delete trazaGrabada;
+            return 1;
+        }
+    } else if (argc > 1) {
+        return ejecutarModoPruebas(argc, argv);
+    }
+
+    AlmacenPerfiles* almacen = new AlmacenPerfiles(PREFIJO_ALMACEN, NUM_FRAGMENTOS);
+
+    // La carga sigue en segundo plano mientras se muestra el menu
+    bool hayDatos = almacen->hayDatosGuardados();
+    almacen->cargarEnParalelo(0);
+    if (!hayDatos) {
+        inicializarPerfiles(almacen);
+    }
 
     int opcion = 0;
 
-    while (opcion != 3) {
+    while (opcion != 4) {
         opcion = mostrarMenuPrincipal();
 
         if (opcion == 1) {
-            mostrarPerfiles(perfiles);
+            mostrarPerfiles(almacen->obtenerTodos());
         } else if (opcion == 2) {
-            Perfil* perfilActual = seleccionarPerfil(perfiles);
-            menuPerfil(perfilActual, perfiles);
+            Perfil* perfilActual = seleccionarPerfil(almacen);
+            if (perfilActual == nullptr) {
+                std::cout << "No existe ese perfil.\n";
+            } else {
+                std::string usuario = perfilActual->getNombreUsuario();
+                grabarOperacion(OP_LOGIN, &usuario, 1);
+                menuPerfil(perfilActual, almacen);
+            }
         } else if (opcion == 3) {
+            buscarPerfilesPorTelefono(almacen);
+        } else if (opcion == 4) {
             std::cout << "Saliendo del programa...\n";
         } else {
             std::cout << "Opcion invalida.\n";
         }
     }
 
-    // Liberación básica de memoria
-    int total = perfiles->getSize();
-    for (int i = 0; i < total; i++) {
-        delete perfiles->obtener_en(i);
+    if (!almacen->guardar()) {
+        std::cout << "No se han podido guardar todos los perfiles.\n";
     }
-    delete perfiles;
+
+    // El almacen es dueno de los perfiles: libera perfiles y contactos
+    delete almacen;
+    delete trazaGrabada;
 
     return 0;
 }